@@ -3,29 +3,104 @@ import 'dart:ffi';
 import 'dart:io' show Platform;
 import 'dart:typed_data';
 import 'dart:math' as math;
-import 'package:ffi/ffi.dart' as ffiMemory;
 import 'dart:developer' as devLog;
 
 // --- FFI Bindings Setup ---
-typedef SolveIncompressibilityNative = Void Function(
-    Pointer<Float> u,
-    Pointer<Float> v,
-    Pointer<Float> p,
-    Pointer<Float> s,
-    Pointer<Int32> cellType,
-    Pointer<Float> particleDensity,
+final class SimContext extends Opaque {}
+
+typedef SimCreateNative = Pointer<SimContext> Function(
     Int32 fNumX,
     Int32 fNumY,
-    Int32 numIters,
     Float h,
-    Float dt,
     Float density,
-    Float overRelaxation,
-    Float particleRestDensity,
-    Bool compensateDrift,
+    Int32 maxParticles,
+    Float particleRadius,
+    Int32 pNumX,
+    Int32 pNumY,
+    Float pInvSpacing,
     Float circleCenterX,
     Float circleCenterY,
     Float circleRadius,
+    Bool enableDynamicColoring);
+
+typedef SimCreateDart = Pointer<SimContext> Function(
+    int fNumX,
+    int fNumY,
+    double h,
+    double density,
+    int maxParticles,
+    double particleRadius,
+    int pNumX,
+    int pNumY,
+    double pInvSpacing,
+    double circleCenterX,
+    double circleCenterY,
+    double circleRadius,
+    bool enableDynamicColoring);
+
+typedef SimDestroyNative = Void Function(Pointer<SimContext> ctx);
+typedef SimDestroyDart = void Function(Pointer<SimContext> ctx);
+
+typedef SimGetBufferNative = Pointer<Void> Function(Pointer<SimContext> ctx, Int32 bufferId);
+typedef SimGetBufferDart = Pointer<Void> Function(Pointer<SimContext> ctx, int bufferId);
+
+typedef SimGetParticleRestDensityNative = Float Function(Pointer<SimContext> ctx);
+typedef SimGetParticleRestDensityDart = double Function(Pointer<SimContext> ctx);
+
+typedef SimSetPressureSolverNative = Void Function(Pointer<SimContext> ctx, Int32 pressureSolver);
+typedef SimSetPressureSolverDart = void Function(Pointer<SimContext> ctx, int pressureSolver);
+
+typedef SimSetPressureToleranceNative = Void Function(
+    Pointer<SimContext> ctx, Float tolerance, Int32 checkInterval);
+typedef SimSetPressureToleranceDart = void Function(
+    Pointer<SimContext> ctx, double tolerance, int checkInterval);
+
+typedef SimSetPressureWarmStartNative = Void Function(Pointer<SimContext> ctx, Bool warmStart);
+typedef SimSetPressureWarmStartDart = void Function(Pointer<SimContext> ctx, bool warmStart);
+
+typedef SimSetReorderIntervalNative = Void Function(Pointer<SimContext> ctx, Int32 interval);
+typedef SimSetReorderIntervalDart = void Function(Pointer<SimContext> ctx, int interval);
+typedef SimSetSeparationModeNative = Void Function(Pointer<SimContext> ctx, Int32 mode);
+typedef SimSetSeparationModeDart = void Function(Pointer<SimContext> ctx, int mode);
+typedef SimSetParticleLayoutNative = Void Function(Pointer<SimContext> ctx, Int32 layout);
+typedef SimSetParticleLayoutDart = void Function(Pointer<SimContext> ctx, int layout);
+typedef SimSetThreadConfigNative = Void Function(
+    Pointer<SimContext> ctx, Int32 threadBudget, Int32 affinity, Int32 spinMillis);
+typedef SimSetThreadConfigDart = void Function(
+    Pointer<SimContext> ctx, int threadBudget, int affinity, int spinMillis);
+typedef SimSetGovernorNative = Void Function(
+    Pointer<SimContext> ctx, Bool enabled, Float targetFrameMs,
+    Int32 minPressureIters, Int32 minParticleIters, Int32 minThreads, Int32 maxThreads,
+    Bool mayDropSeparation, Bool mayDropColoring, Float throttleTemperature);
+typedef SimSetGovernorDart = void Function(
+    Pointer<SimContext> ctx, bool enabled, double targetFrameMs,
+    int minPressureIters, int minParticleIters, int minThreads, int maxThreads,
+    bool mayDropSeparation, bool mayDropColoring, double throttleTemperature);
+typedef SimSetGovernorTemperatureNative = Void Function(Pointer<SimContext> ctx, Float celsius);
+typedef SimSetGovernorTemperatureDart = void Function(Pointer<SimContext> ctx, double celsius);
+typedef SimSeedParticlesNative = Int32 Function(Pointer<SimContext> ctx, Int32 targetCount);
+typedef SimSeedParticlesDart = int Function(Pointer<SimContext> ctx, int targetCount);
+typedef SimGetSeedFillHeightNative = Float Function(Pointer<SimContext> ctx);
+typedef SimGetSeedFillHeightDart = double Function(Pointer<SimContext> ctx);
+
+typedef SimGetPressureIterationsNative = Int32 Function(Pointer<SimContext> ctx);
+typedef SimGetPressureIterationsDart = int Function(Pointer<SimContext> ctx);
+
+typedef SimGetPressureResidualNative = Float Function(Pointer<SimContext> ctx);
+typedef SimGetPressureResidualDart = double Function(Pointer<SimContext> ctx);
+
+typedef SimStepNative = Void Function(
+    Pointer<SimContext> ctx,
+    Int32 numParticles,
+    Float dt,
+    Float gravityX,
+    Float gravityY,
+    Float flipRatio,
+    Int32 numPressureIters,
+    Int32 numParticleIters,
+    Float overRelaxation,
+    Bool compensateDrift,
+    Bool separateParticles,
     Bool isObstacleActive,
     Float obstacleX,
     Float obstacleY,
@@ -33,37 +108,18 @@ typedef SolveIncompressibilityNative = Void Function(
     Float obstacleVelX,
     Float obstacleVelY);
 
-typedef PushParticlesApartNative = Void Function(
-    Pointer<Float> particlePos,
-    Pointer<Int32> firstCellParticle,
-    Pointer<Int32> cellParticleIds,
-    Int32 numParticles,
-    Int32 pNumX,
-    Int32 pNumY,
-    Float pInvSpacing,
-    Int32 numIters,
-    Float particleRadius,
-    Float minDist2);
-
-typedef SolveIncompressibilityDart = void Function(
-    Pointer<Float> u,
-    Pointer<Float> v,
-    Pointer<Float> p,
-    Pointer<Float> s,
-    Pointer<Int32> cellType,
-    Pointer<Float> particleDensity,
-    int fNumX,
-    int fNumY,
-    int numIters,
-    double h,
+typedef SimStepDart = void Function(
+    Pointer<SimContext> ctx,
+    int numParticles,
     double dt,
-    double density,
+    double gravityX,
+    double gravityY,
+    double flipRatio,
+    int numPressureIters,
+    int numParticleIters,
     double overRelaxation,
-    double particleRestDensity,
     bool compensateDrift,
-    double circleCenterX,
-    double circleCenterY,
-    double circleRadius,
+    bool separateParticles,
     bool isObstacleActive,
     double obstacleX,
     double obstacleY,
@@ -71,152 +127,313 @@ typedef SolveIncompressibilityDart = void Function(
     double obstacleVelX,
     double obstacleVelY);
 
-typedef PushParticlesApartDart = void Function(
-    Pointer<Float> particlePos,
-    Pointer<Int32> firstCellParticle,
-    Pointer<Int32> cellParticleIds,
+typedef SimStepFrameNative = Int32 Function(
+    Pointer<SimContext> ctx,
+    Int32 numParticles,
+    Float frameDt,
+    Int32 maxSubsteps,
+    Float cflNumber,
+    Float gravityX,
+    Float gravityY,
+    Float flipRatio,
+    Int32 numPressureIters,
+    Int32 numParticleIters,
+    Float overRelaxation,
+    Bool compensateDrift,
+    Bool separateParticles,
+    Bool isObstacleActive,
+    Float obstacleX,
+    Float obstacleY,
+    Float obstacleRadius,
+    Float obstacleVelX,
+    Float obstacleVelY);
+
+typedef SimStepFrameDart = int Function(
+    Pointer<SimContext> ctx,
     int numParticles,
-    int pNumX,
-    int pNumY,
-    double pInvSpacing,
-    int numIters,
-    double particleRadius,
-    double minDist2);
-
-typedef TransferVelocitiesNative = Void Function(
-    Bool toGrid, Float flipRatio,
-    Pointer<Float> u, Pointer<Float> v, Pointer<Float> du, Pointer<Float> dv,
-    Pointer<Float> prevU, Pointer<Float> prevV,
-    Pointer<Int32> cellType,
-    Pointer<Float> s,
-    Pointer<Float> particlePos,
-    Pointer<Float> particleVel,
-    Int32 fNumX, Int32 fNumY, Float h, Float invH,
-    Int32 numParticles
-);
-
-typedef TransferVelocitiesDart = void Function(
-    bool toGrid, double flipRatio,
-    Pointer<Float> u, Pointer<Float> v, Pointer<Float> du, Pointer<Float> dv,
-    Pointer<Float> prevU, Pointer<Float> prevV,
-    Pointer<Int32> cellType,
-    Pointer<Float> s,
-    Pointer<Float> particlePos,
-    Pointer<Float> particleVel,
-    int fNumX, int fNumY, double h, double invH,
-    int numParticles
-);
-
-typedef UpdateParticleDensityGridNative = Void Function(
-    Int32 numParticles, Float particleRestDensity, Float invH,
-    Int32 fNumX, Int32 fNumY, Float h,
-    Pointer<Float> particlePos,
-    Pointer<Float> particleDensityGrid
-);
-typedef UpdateParticleDensityGridDart = void Function(
-    int numParticles, double particleRestDensity, double invH,
-    int fNumX, int fNumY, double h,
-    Pointer<Float> particlePos,
-    Pointer<Float> particleDensityGrid
-);
-
-typedef UpdateDynamicParticleColorsNative = Void Function(
-    Int32 numParticles, Float particleRestDensity, Float invH,
-    Int32 fNumX, Int32 fNumY, Float h,
-    Pointer<Float> particlePos, Pointer<Float> particleDensityGrid,
-    Pointer<Float> particleColor
-);
-typedef UpdateDynamicParticleColorsDart = void Function(
-    int numParticles, double particleRestDensity, double invH,
-    int fNumX, int fNumY, double h,
-    Pointer<Float> particlePos, Pointer<Float> particleDensityGrid,
-    Pointer<Float> particleColor
-);
-
-typedef DiffuseParticleColorsNative = Void Function(
-    Pointer<Float> particlePos,
-    Pointer<Float> particleColor,
-    Pointer<Int32> firstCellParticle,
-    Pointer<Int32> cellParticleIds,
+    double frameDt,
+    int maxSubsteps,
+    double cflNumber,
+    double gravityX,
+    double gravityY,
+    double flipRatio,
+    int numPressureIters,
+    int numParticleIters,
+    double overRelaxation,
+    bool compensateDrift,
+    bool separateParticles,
+    bool isObstacleActive,
+    double obstacleX,
+    double obstacleY,
+    double obstacleRadius,
+    double obstacleVelX,
+    double obstacleVelY);
+
+typedef SimSetFrameParamsNative = Void Function(
+    Pointer<SimContext> ctx,
     Int32 numParticles,
-    Int32 pNumX,
-    Int32 pNumY,
-    Float pInvSpacing,
-    Float particleRadius,
-    Bool enableDynamicColoring,
-    Float colorDiffusionCoeff);
-
-typedef DiffuseParticleColorsDart = void Function(
-    Pointer<Float> particlePos,
-    Pointer<Float> particleColor,
-    Pointer<Int32> firstCellParticle,
-    Pointer<Int32> cellParticleIds,
+    Float frameDt,
+    Int32 maxSubsteps,
+    Float cflNumber,
+    Float gravityX,
+    Float gravityY,
+    Float flipRatio,
+    Int32 numPressureIters,
+    Int32 numParticleIters,
+    Float overRelaxation,
+    Bool compensateDrift,
+    Bool separateParticles,
+    Bool isObstacleActive,
+    Float obstacleX,
+    Float obstacleY,
+    Float obstacleRadius,
+    Float obstacleVelX,
+    Float obstacleVelY);
+
+typedef SimSetFrameParamsDart = void Function(
+    Pointer<SimContext> ctx,
     int numParticles,
-    int pNumX,
-    int pNumY,
-    double pInvSpacing,
-    double particleRadius,
-    bool enableDynamicColoring,
-    double colorDiffusionCoeff);
-
-typedef HandleCollisionsNative = Void Function(
-    Pointer<Float> particlePos, Pointer<Float> particleVel,
-    Int32 numParticles, Float particleRadius,
-    Bool isObstacleActive, Float obstacleX, Float obstacleY, Float obstacleRadius,
-    Float obstacleVelX, Float obstacleVelY,
-    Float sceneCircleCenterX, Float sceneCircleCenterY, Float sceneCircleRadius
-);
-typedef HandleCollisionsDart = void Function(
-    Pointer<Float> particlePos, Pointer<Float> particleVel,
-    int numParticles, double particleRadius,
-    bool isObstacleActive, double obstacleX, double obstacleY, double obstacleRadius,
-    double obstacleVelX, double obstacleVelY,
-    double sceneCircleCenterX, double sceneCircleCenterY, double sceneCircleRadius
-);
+    double frameDt,
+    int maxSubsteps,
+    double cflNumber,
+    double gravityX,
+    double gravityY,
+    double flipRatio,
+    int numPressureIters,
+    int numParticleIters,
+    double overRelaxation,
+    bool compensateDrift,
+    bool separateParticles,
+    bool isObstacleActive,
+    double obstacleX,
+    double obstacleY,
+    double obstacleRadius,
+    double obstacleVelX,
+    double obstacleVelY);
+
+typedef SimStartThreadNative = Bool Function(Pointer<SimContext> ctx, Float stepsPerSecond);
+typedef SimStartThreadDart = bool Function(Pointer<SimContext> ctx, double stepsPerSecond);
+typedef SimStopThreadNative = Void Function(Pointer<SimContext> ctx);
+typedef SimStopThreadDart = void Function(Pointer<SimContext> ctx);
+typedef SimAcquireSnapshotNative = Int32 Function(Pointer<SimContext> ctx);
+typedef SimAcquireSnapshotDart = int Function(Pointer<SimContext> ctx);
+typedef SimGetSnapshotBufferNative = Pointer<Void> Function(Pointer<SimContext> ctx, Int32 slot, Int32 bufferId);
+typedef SimGetSnapshotBufferDart = Pointer<Void> Function(Pointer<SimContext> ctx, int slot, int bufferId);
+
+typedef SimSetObstacleNative = Void Function(Pointer<SimContext> ctx, Bool isObstacleActive,
+    Float obstacleX, Float obstacleY, Float obstacleRadius, Float obstacleVelX, Float obstacleVelY);
+typedef SimSetObstacleDart = void Function(Pointer<SimContext> ctx, bool isObstacleActive,
+    double obstacleX, double obstacleY, double obstacleRadius, double obstacleVelX, double obstacleVelY);
+typedef SimResetGridNative = Void Function(Pointer<SimContext> ctx);
+typedef SimResetGridDart = void Function(Pointer<SimContext> ctx);
+
+// Buffer ids for sim_get_buffer (must match SimBufferId in simulation_native.cpp)
+class SimBuffer {
+  static const int u = 0;
+  static const int v = 1;
+  static const int du = 2;
+  static const int dv = 3;
+  static const int prevU = 4;
+  static const int prevV = 5;
+  static const int p = 6;
+  static const int s = 7;
+  static const int cellType = 8;
+  static const int particleDensity = 9;
+  static const int particlePos = 10;
+  static const int particleVel = 11;
+  static const int particleGrade = 12; // uint16 unorm color grade (0 deep .. 65535 surface)
+  static const int stageTimings = 13; // float[SimStage.count], ms of the last step
+  static const int particlePermutation = 14; // int32, old index of each particle after the last reorder
+  static const int particleX = 15; // SoA particle store (ParticleLayout.soa), float[maxParticles] each
+  static const int particleY = 16;
+  static const int particleVelX = 17;
+  static const int particleVelY = 18;
+  static const int snapshotInfo = 19; // float[SnapshotInfo.count], sim_get_snapshot_buffer only
+  static const int governorState = 20; // float[GovernorState.count], settings chosen by the governor
+}
+
+// Quality governor outputs (must match GovernorStateField in simulation_native.cpp)
+class GovernorState {
+  static const int pressureIters = 0;
+  static const int particleIters = 1;
+  static const int separation = 2; // 1 = on
+  static const int coloring = 3; // 1 = on
+  static const int threads = 4;
+  static const int smoothedMs = 5;
+  static const int budgetMs = 6; // Target after thermal scaling
+  static const int count = 7;
+}
+
+// Scalars of a render snapshot (must match SnapshotInfo in simulation_native.cpp)
+class SnapshotInfo {
+  static const int numParticles = 0;
+  static const int restDensity = 1;
+  static const int pressureIterations = 2;
+  static const int pressureResidual = 3;
+  static const int substeps = 4;
+  static const int count = 5;
+}
+
+// Particle buffer layouts (must match PARTICLE_LAYOUT_* in simulation_native.cpp)
+class ParticleLayout {
+  static const int interleaved = 0; // particlePos / particleVel, converted around every step
+  static const int soa = 1; // particleX / particleY / particleVelX / particleVelY, no conversion
+}
+
+// Stages timed by sim_step (must match SimStage in simulation_native.cpp)
+class SimStage {
+  static const int integrate = 0;
+  static const int particleGrid = 1;
+  static const int reorder = 2;
+  static const int pushApart = 3;
+  static const int colorDiffusion = 4;
+  static const int collisions = 5;
+  static const int p2g = 6;
+  static const int density = 7;
+  static const int pressure = 8;
+  static const int g2p = 9;
+  static const int total = 10;
+  static const int count = 11;
+}
+
+// Particle separation modes (must match SEPARATION_* in simulation_native.cpp)
+class SeparationMode {
+  static const int gaussSeidel = 0; // Serial in-place sweep
+  static const int colored = 1; // Parallel sweep over 9-colored cells
+  static const int jacobi = 2; // Parallel accumulate-then-apply
+}
+
+// Worker placement (must match THREAD_AFFINITY_* in simulation_native.cpp)
+class ThreadAffinity {
+  static const int any = 0; // OS scheduler decides
+  static const int big = 1; // Fastest cores
+  static const int little = 2; // Slowest cores
+}
+
+// Pressure solver modes (must match PRESSURE_SOLVER_* in simulation_native.cpp)
+class PressureSolver {
+  static const int gaussSeidel = 0;
+  static const int redBlackSor = 1;
+  static const int pcg = 2;
+  static const int multigridPcg = 3;
+}
 
 class _SimulationFFI {
   static final _SimulationFFI _instance = _SimulationFFI._internal();
   factory _SimulationFFI() => _instance;
 
   late final DynamicLibrary _dylib;
-  late final SolveIncompressibilityDart solveIncompressibility;
-  late final PushParticlesApartDart pushParticlesApart;
-  late final TransferVelocitiesDart transferVelocities;
-  late final UpdateParticleDensityGridDart updateParticleDensityGrid;
-  late final UpdateDynamicParticleColorsDart updateDynamicParticleColors;
-  late final HandleCollisionsDart handleCollisions;
-  late final DiffuseParticleColorsDart diffuseParticleColors;
-
+  late final SimCreateDart simCreate;
+  late final SimDestroyDart simDestroy;
+  late final SimGetBufferDart simGetBuffer;
+  late final SimGetParticleRestDensityDart simGetParticleRestDensity;
+  late final SimSetPressureSolverDart simSetPressureSolver;
+  late final SimSetPressureToleranceDart simSetPressureTolerance;
+  late final SimSetPressureWarmStartDart simSetPressureWarmStart;
+  late final SimSetReorderIntervalDart simSetReorderInterval;
+  late final SimSetSeparationModeDart simSetSeparationMode;
+  late final SimSetParticleLayoutDart simSetParticleLayout;
+  late final SimSetThreadConfigDart simSetThreadConfig;
+  late final SimSetGovernorDart simSetGovernor;
+  late final SimSetGovernorTemperatureDart simSetGovernorTemperature;
+  late final SimSeedParticlesDart simSeedParticles;
+  late final SimGetSeedFillHeightDart simGetSeedFillHeight;
+  late final SimGetPressureIterationsDart simGetPressureIterations;
+  late final SimGetPressureResidualDart simGetPressureResidual;
+  late final SimStepDart simStep;
+  late final SimStepFrameDart simStepFrame;
+  late final SimSetFrameParamsDart simSetFrameParams;
+  late final SimStartThreadDart simStartThread;
+  late final SimStopThreadDart simStopThread;
+  late final SimAcquireSnapshotDart simAcquireSnapshot;
+  late final SimGetSnapshotBufferDart simGetSnapshotBuffer;
+  late final SimSetObstacleDart simSetObstacle;
+  late final SimResetGridDart simResetGrid;
+
+  // Only O(1) calls that never take a native lock are leaf calls. Everything that
+  // steps, allocates, joins the simulation thread or waits on its locks is not,
+  // so the VM can still reach safepoints (GC) while the call blocks.
   _SimulationFFI._internal() {
     _dylib = _loadLibrary();
-    solveIncompressibility = _dylib
-        .lookup<NativeFunction<SolveIncompressibilityNative>>(
-            'solveIncompressibility_native')
-        .asFunction<SolveIncompressibilityDart>(isLeaf: true);
-    pushParticlesApart = _dylib
-        .lookup<NativeFunction<PushParticlesApartNative>>(
-            'pushParticlesApart_native')
-        .asFunction<PushParticlesApartDart>(isLeaf: true);
-    transferVelocities = _dylib
-        .lookup<NativeFunction<TransferVelocitiesNative>>(
-            'transferVelocities_native')
-        .asFunction<TransferVelocitiesDart>(isLeaf: true);
-    updateParticleDensityGrid = _dylib
-        .lookup<NativeFunction<UpdateParticleDensityGridNative>>(
-            'updateParticleDensityGrid_native')
-        .asFunction<UpdateParticleDensityGridDart>(isLeaf: true);
-    updateDynamicParticleColors = _dylib
-        .lookup<NativeFunction<UpdateDynamicParticleColorsNative>>(
-            'updateDynamicParticleColors_native')
-        .asFunction<UpdateDynamicParticleColorsDart>(isLeaf: true);
-    handleCollisions = _dylib
-        .lookup<NativeFunction<HandleCollisionsNative>>(
-            'handleCollisions_native')
-        .asFunction<HandleCollisionsDart>(isLeaf: true);
-    diffuseParticleColors = _dylib
-        .lookup<NativeFunction<DiffuseParticleColorsNative>>(
-            'diffuseParticleColors_native')
-        .asFunction<DiffuseParticleColorsDart>(isLeaf: true);
+    simCreate = _dylib
+        .lookup<NativeFunction<SimCreateNative>>('sim_create')
+        .asFunction<SimCreateDart>();
+    simDestroy = _dylib
+        .lookup<NativeFunction<SimDestroyNative>>('sim_destroy')
+        .asFunction<SimDestroyDart>();
+    simGetBuffer = _dylib
+        .lookup<NativeFunction<SimGetBufferNative>>('sim_get_buffer')
+        .asFunction<SimGetBufferDart>(isLeaf: true);
+    simGetParticleRestDensity = _dylib
+        .lookup<NativeFunction<SimGetParticleRestDensityNative>>(
+            'sim_get_particle_rest_density')
+        .asFunction<SimGetParticleRestDensityDart>(isLeaf: true);
+    simSetPressureSolver = _dylib
+        .lookup<NativeFunction<SimSetPressureSolverNative>>('sim_set_pressure_solver')
+        .asFunction<SimSetPressureSolverDart>();
+    simSetPressureTolerance = _dylib
+        .lookup<NativeFunction<SimSetPressureToleranceNative>>('sim_set_pressure_tolerance')
+        .asFunction<SimSetPressureToleranceDart>();
+    simSetPressureWarmStart = _dylib
+        .lookup<NativeFunction<SimSetPressureWarmStartNative>>('sim_set_pressure_warm_start')
+        .asFunction<SimSetPressureWarmStartDart>();
+    simSetReorderInterval = _dylib
+        .lookup<NativeFunction<SimSetReorderIntervalNative>>('sim_set_reorder_interval')
+        .asFunction<SimSetReorderIntervalDart>();
+    simSetSeparationMode = _dylib
+        .lookup<NativeFunction<SimSetSeparationModeNative>>('sim_set_separation_mode')
+        .asFunction<SimSetSeparationModeDart>();
+    simSetParticleLayout = _dylib
+        .lookup<NativeFunction<SimSetParticleLayoutNative>>('sim_set_particle_layout')
+        .asFunction<SimSetParticleLayoutDart>();
+    simSetThreadConfig = _dylib
+        .lookup<NativeFunction<SimSetThreadConfigNative>>('sim_set_thread_config')
+        .asFunction<SimSetThreadConfigDart>();
+    simSetGovernor = _dylib
+        .lookup<NativeFunction<SimSetGovernorNative>>('sim_set_governor')
+        .asFunction<SimSetGovernorDart>();
+    simSetGovernorTemperature = _dylib
+        .lookup<NativeFunction<SimSetGovernorTemperatureNative>>('sim_set_governor_temperature')
+        .asFunction<SimSetGovernorTemperatureDart>(isLeaf: true);
+    simSeedParticles = _dylib
+        .lookup<NativeFunction<SimSeedParticlesNative>>('sim_seed_particles')
+        .asFunction<SimSeedParticlesDart>();
+    simGetSeedFillHeight = _dylib
+        .lookup<NativeFunction<SimGetSeedFillHeightNative>>('sim_get_seed_fill_height')
+        .asFunction<SimGetSeedFillHeightDart>(isLeaf: true);
+    simGetPressureIterations = _dylib
+        .lookup<NativeFunction<SimGetPressureIterationsNative>>('sim_get_pressure_iterations')
+        .asFunction<SimGetPressureIterationsDart>(isLeaf: true);
+    simGetPressureResidual = _dylib
+        .lookup<NativeFunction<SimGetPressureResidualNative>>('sim_get_pressure_residual')
+        .asFunction<SimGetPressureResidualDart>(isLeaf: true);
+    simStep = _dylib
+        .lookup<NativeFunction<SimStepNative>>('sim_step')
+        .asFunction<SimStepDart>();
+    simStepFrame = _dylib
+        .lookup<NativeFunction<SimStepFrameNative>>('sim_step_frame')
+        .asFunction<SimStepFrameDart>(); // Runs whole substeps: not a leaf call
+    simSetFrameParams = _dylib
+        .lookup<NativeFunction<SimSetFrameParamsNative>>('sim_set_frame_params')
+        .asFunction<SimSetFrameParamsDart>();
+    simStartThread = _dylib
+        .lookup<NativeFunction<SimStartThreadNative>>('sim_start_thread')
+        .asFunction<SimStartThreadDart>();
+    simStopThread = _dylib
+        .lookup<NativeFunction<SimStopThreadNative>>('sim_stop_thread')
+        .asFunction<SimStopThreadDart>();
+    simAcquireSnapshot = _dylib
+        .lookup<NativeFunction<SimAcquireSnapshotNative>>('sim_acquire_snapshot')
+        .asFunction<SimAcquireSnapshotDart>(isLeaf: true);
+    simGetSnapshotBuffer = _dylib
+        .lookup<NativeFunction<SimGetSnapshotBufferNative>>('sim_get_snapshot_buffer')
+        .asFunction<SimGetSnapshotBufferDart>(isLeaf: true);
+    simSetObstacle = _dylib
+        .lookup<NativeFunction<SimSetObstacleNative>>('sim_set_obstacle')
+        .asFunction<SimSetObstacleDart>();
+    simResetGrid = _dylib
+        .lookup<NativeFunction<SimResetGridNative>>('sim_reset_grid')
+        .asFunction<SimResetGridDart>();
   }
 
   DynamicLibrary _loadLibrary() {
@@ -269,17 +486,42 @@ class FlipFluidSimulation {
   late final double h;
   late final double fInvSpacing;
 
-  late final Float32List u, v, du, dv, prevU, prevV, p, s, cellColor;
-  late final Int32List cellType;
+  // Grid and particle fields are zero-copy views onto SimContext-owned memory.
+  late final Float32List u, v, du, dv, prevU, prevV, p, s;
+  late final Float32List cellColor;
+  late Int32List cellType; // Live view, or the latest snapshot while simulating in the background
+
+  static const double gradeScale = 65535.0; // particleGrade value of a full surface highlight
 
   final int maxParticles;
   int numParticles = 0;
-  final Float32List particlePos, particleVel, particleColor;
-  late final Float32List particleDensity;
-  late final Int32List numCellParticles, firstCellParticle;
-  final Int32List cellParticleIds;
+  // Render-facing views: the live SoA store, or the latest snapshot in background mode
+  late Float32List particleX, particleY;
+  late final Float32List particleVelX, particleVelY; // Live SoA views
+  late Uint16List particleGrade; // Color grade, see gradeScale
+  late Float32List particleDensity;
+  late Float32List stageTimings; // ms per SimStage of the last frame
+  late Float32List governorState; // GovernorState fields, all zero while the governor is off
+
+  // Background simulation (see backgroundStepsPerSecond)
+  double _backgroundStepsPerSecond = 0.0;
+  final List<_SnapshotViews?> _snapshotViews = List.filled(3, null);
+  int _snapshotSlot = -1;
 
   double particleRestDensity = 0.0;
+  int _pressureSolver = PressureSolver.gaussSeidel;
+  double _pressureTolerance = 0.0; // <= 0: fixed iteration count
+  int _pressureCheckInterval = 5;
+  bool _pressureWarmStart = false;
+  int _reorderInterval = 0;
+  int _separationMode = SeparationMode.gaussSeidel;
+  int _threadBudget = 2, _threadAffinity = ThreadAffinity.any, _threadSpinMillis = -1;
+  (bool, double, int, int, int, int, bool, bool, double)? _governorConfig;
+  double _governorTemperature = -1000.0;
+  // Stats of the last pressure solve; residual is negative when the solver does not measure it.
+  int pressureIterations = 0;
+  double pressureResidual = -1.0;
+  int substeps = 0; // Substeps taken by the last simulate() frame
   final double particleRadius, pInvSpacing;
   final int pNumX, pNumY;
   late final int pNumCells;
@@ -289,19 +531,12 @@ class FlipFluidSimulation {
   double obstacleRadius;
   bool isObstacleActive = false;
 
-  bool _lastLoggedObstActiveForCollisions = false;
-  double _lastLoggedObstXForCollisions = 0.0;
-  double _lastLoggedObstYForCollisions = 0.0;
-  double _lastLoggedObstRForCollisions = 0.0;
-  double _lastLoggedObstVelXForCollisions = 0.0;
-  double _lastLoggedObstVelYForCollisions = 0.0;
-
-  bool _lastLoggedObstActiveForSolveIncompressibility = false;
-  double _lastLoggedObstXForSolveIncompressibility = 0.0;
-  double _lastLoggedObstYForSolveIncompressibility = 0.0;
-  double _lastLoggedObstRForSolveIncompressibility = 0.0;
-  double _lastLoggedObstVelXForSolveIncompressibility = 0.0;
-  double _lastLoggedObstVelYForSolveIncompressibility = 0.0;
+  bool _lastLoggedObstActiveForStep = false;
+  double _lastLoggedObstXForStep = 0.0;
+  double _lastLoggedObstYForStep = 0.0;
+  double _lastLoggedObstRForStep = 0.0;
+  double _lastLoggedObstVelXForStep = 0.0;
+  double _lastLoggedObstVelYForStep = 0.0;
 
   late final double sceneCircleCenterX;
   late final double sceneCircleCenterY;
@@ -310,21 +545,7 @@ class FlipFluidSimulation {
 
   final _ffi = _SimulationFFI();
 
-  late final Pointer<Float> _nativeUPtr;
-  late final Pointer<Float> _nativeVPtr;
-  late final Pointer<Float> _nativePPtr;
-  late final Pointer<Float> _nativeSPtr;
-  late final Pointer<Int32> _nativeCellTypePtr;
-  late final Pointer<Float> _nativeParticleDensityPtr;
-  late final Pointer<Float> _nativeParticlePosPtr;
-  late final Pointer<Int32> _nativeFirstCellParticlePtr;
-  late final Pointer<Int32> _nativeCellParticleIdsPtr;
-  late final Pointer<Float> _nativeDuPtr;
-  late final Pointer<Float> _nativeDvPtr;
-  late final Pointer<Float> _nativePrevUPtr;
-  late final Pointer<Float> _nativePrevVPtr;
-  late final Pointer<Float> _nativeParticleVelPtr;
-  late final Pointer<Float> _nativeParticleColorPtr;
+  late final Pointer<SimContext> _ctx;
 
   FlipFluidSimulation({
     required this.density,
@@ -340,40 +561,14 @@ class FlipFluidSimulation {
         fNumX = cellsWide,
         pInvSpacing = 1.0 / (2.2 * particleRadius),
         pNumX = (width * (1.0 / (2.2 * particleRadius))).floor() + 1,
-        pNumY = (height * (1.0 / (2.2 * particleRadius))).floor() + 1,
-        particlePos = Float32List(2 * maxParticles),
-        particleVel = Float32List(2 * maxParticles),
-        particleColor = Float32List(4 * maxParticles), // Changed for RGBA
-        cellParticleIds = Int32List(maxParticles) {
+        pNumY = (height * (1.0 / (2.2 * particleRadius))).floor() + 1 {
     h = worldWidth / fNumX.toDouble();
     fNumY = (worldHeight / h).floor() + 1;
     fInvSpacing = 1.0 / h;
     fNumCells = fNumX * fNumY;
 
-    u = Float32List(fNumCells);
-    v = Float32List(fNumCells);
-    du = Float32List(fNumCells);
-    dv = Float32List(fNumCells);
-    prevU = Float32List(fNumCells);
-    prevV = Float32List(fNumCells);
-    p = Float32List(fNumCells);
-    s = Float32List(fNumCells);
-    cellColor = Float32List(3 * fNumCells);
-    cellType = Int32List(fNumCells);
-    particleDensity = Float32List(fNumCells);
-
     pNumCells = pNumX * pNumY;
 
-    for (int i = 0; i < maxParticles; ++i) {
-      particleColor[4 * i] = 0.0;         // R
-      particleColor[4 * i + 1] = 0.0;     // G
-      particleColor[4 * i + 2] = 1.0;     // B
-      particleColor[4 * i + 3] = 1.0;     // A (opaque)
-    }
-    
-    numCellParticles = Int32List(this.pNumCells);
-    firstCellParticle = Int32List(this.pNumCells + 1);
-
     final double simDomainWidth = fNumX.toDouble() * h;
     final double simDomainHeight = fNumY.toDouble() * h;
     sceneCircleCenterX = simDomainWidth / 2.0;
@@ -381,58 +576,193 @@ class FlipFluidSimulation {
     sceneCircleRadius = 0.95 * 0.5 * math.min(simDomainWidth, simDomainHeight);
 
     try {
-      _nativeUPtr = ffiMemory.calloc<Float>(u.length);
-      _nativeVPtr = ffiMemory.calloc<Float>(v.length);
-      _nativePPtr = ffiMemory.calloc<Float>(p.length);
-      _nativeSPtr = ffiMemory.calloc<Float>(s.length);
-      _nativeCellTypePtr = ffiMemory.calloc<Int32>(cellType.length);
-      _nativeParticleDensityPtr = ffiMemory.calloc<Float>(particleDensity.length);
-      _nativeParticlePosPtr = ffiMemory.calloc<Float>(particlePos.length);
-      _nativeFirstCellParticlePtr = ffiMemory.calloc<Int32>(firstCellParticle.length);
-      _nativeCellParticleIdsPtr = ffiMemory.calloc<Int32>(cellParticleIds.length);
-      _nativeDuPtr = ffiMemory.calloc<Float>(du.length);
-      _nativeDvPtr = ffiMemory.calloc<Float>(dv.length);
-      _nativePrevUPtr = ffiMemory.calloc<Float>(prevU.length);
-      _nativePrevVPtr = ffiMemory.calloc<Float>(prevV.length);
-      _nativeParticleVelPtr = ffiMemory.calloc<Float>(particleVel.length);
-      _nativeParticleColorPtr = ffiMemory.calloc<Float>(particleColor.length);
-
-      if (_nativeUPtr == nullptr || _nativeVPtr == nullptr || _nativePPtr == nullptr ||
-          _nativeSPtr == nullptr || _nativeCellTypePtr == nullptr ||
-          _nativeParticleDensityPtr == nullptr || _nativeParticlePosPtr == nullptr ||
-          _nativeFirstCellParticlePtr == nullptr || _nativeCellParticleIdsPtr == nullptr ||
-          _nativeDuPtr == nullptr || _nativeDvPtr == nullptr || _nativePrevUPtr == nullptr ||
-          _nativePrevVPtr == nullptr || _nativeParticleVelPtr == nullptr ||
-          _nativeParticleColorPtr == nullptr ) {
-       throw Exception("Failed to allocate persistent native FFI buffers.");
+      _ctx = _ffi.simCreate(
+          fNumX, fNumY, h, density,
+          maxParticles, particleRadius,
+          pNumX, pNumY, pInvSpacing,
+          sceneCircleCenterX, sceneCircleCenterY, sceneCircleRadius,
+          enableDynamicColoring);
+      if (_ctx == nullptr) {
+        throw Exception("Failed to create native simulation context.");
       }
     } catch (e) {
-      devLog.log("FATAL ERROR during native buffer allocation: $e", name: 'FlipFluidSim.Error');
+      devLog.log("FATAL ERROR during native context creation: $e", name: 'FlipFluidSim.Error');
       rethrow;
     }
+
+    u = _floatView(SimBuffer.u, fNumCells);
+    v = _floatView(SimBuffer.v, fNumCells);
+    du = _floatView(SimBuffer.du, fNumCells);
+    dv = _floatView(SimBuffer.dv, fNumCells);
+    prevU = _floatView(SimBuffer.prevU, fNumCells);
+    prevV = _floatView(SimBuffer.prevV, fNumCells);
+    p = _floatView(SimBuffer.p, fNumCells);
+    s = _floatView(SimBuffer.s, fNumCells);
+    // Work on the native SoA store directly so sim_step skips the interleaved conversion
+    _ffi.simSetParticleLayout(_ctx, ParticleLayout.soa);
+    particleVelX = _floatView(SimBuffer.particleVelX, maxParticles);
+    particleVelY = _floatView(SimBuffer.particleVelY, maxParticles);
+    _bindLiveViews();
+    cellColor = Float32List(3 * fNumCells);
+
     initializeGrid();
   }
 
-  void initializeGrid() {
-    final int n = fNumY;
-    final double rSq = sceneCircleRadius * sceneCircleRadius;
+  int get pressureSolver => _pressureSolver;
+  set pressureSolver(int mode) {
+    if (mode == _pressureSolver) return;
+    _pressureSolver = mode;
+    _ffi.simSetPressureSolver(_ctx, mode);
+  }
+
+  /// Stops the pressure solve once the max divergence drops to [tolerance],
+  /// checked every [checkInterval] sweeps. A tolerance <= 0 disables the check.
+  void setPressureTolerance(double tolerance, int checkInterval) {
+    if (tolerance == _pressureTolerance && checkInterval == _pressureCheckInterval) return;
+    _pressureTolerance = tolerance;
+    _pressureCheckInterval = checkInterval;
+    _ffi.simSetPressureTolerance(_ctx, tolerance, checkInterval);
+  }
+
+  /// When enabled the native solver starts from the previous frame's pressure
+  /// instead of zero.
+  bool get pressureWarmStart => _pressureWarmStart;
+  set pressureWarmStart(bool enabled) {
+    if (enabled == _pressureWarmStart) return;
+    _pressureWarmStart = enabled;
+    _ffi.simSetPressureWarmStart(_ctx, enabled);
+  }
 
-    for (int i = 0; i < fNumX; i++) {
-      for (int j = 0; j < fNumY; j++) {
-        int idx = i * n + j;
-        double cellRealX = (i + 0.5) * h;
-        double cellRealY = (j + 0.5) * h;
+  /// Sorts the native particle arrays by spatial cell every [frames] steps
+  /// (0 disables). Positions, velocities and colors are permuted together.
+  int get reorderInterval => _reorderInterval;
+  set reorderInterval(int frames) {
+    if (frames == _reorderInterval) return;
+    _reorderInterval = frames;
+    _ffi.simSetReorderInterval(_ctx, frames);
+  }
+
+  int get separationMode => _separationMode;
+  set separationMode(int mode) {
+    if (mode == _separationMode) return;
+    _separationMode = mode;
+    _ffi.simSetSeparationMode(_ctx, mode);
+  }
 
-        double dx = cellRealX - sceneCircleCenterX;
-        double dy = cellRealY - sceneCircleCenterY;
-        double distSqToCenter = dx * dx + dy * dy;
+  /// Native worker pool: [threadBudget] workers (<= 0 uses every core), placed
+  /// per [ThreadAffinity], spinning [spinMillis] ms before parking when idle
+  /// (negative keeps the runtime default). Applies from the next frame.
+  void setThreadConfig(int threadBudget, int affinity, int spinMillis) {
+    if (threadBudget == _threadBudget && affinity == _threadAffinity && spinMillis == _threadSpinMillis) return;
+    _threadBudget = threadBudget;
+    _threadAffinity = affinity;
+    _threadSpinMillis = spinMillis;
+    _ffi.simSetThreadConfig(_ctx, threadBudget, affinity, spinMillis);
+  }
 
-        s[idx] = (distSqToCenter > rSq) ? 0.0 : 1.0;
-        u[idx] = v[idx] = du[idx] = dv[idx] = prevU[idx] = prevV[idx] = p[idx] = 0.0;
+  /// Frame-budget quality governor. While [enabled], the native side keeps the
+  /// smoothed step cost near [targetFrameMs] by lowering the iteration counts
+  /// passed to [simulate] (down to the given minima), moving the worker count
+  /// within [minThreads]..[maxThreads] and, if allowed, switching particle
+  /// separation and dynamic coloring off. Above [throttleTemperature] degrees C
+  /// the target tightens.
+  void setGovernor({
+    required bool enabled, required double targetFrameMs,
+    required int minPressureIters, required int minParticleIters,
+    required int minThreads, required int maxThreads,
+    required bool mayDropSeparation, required bool mayDropColoring,
+    required double throttleTemperature,
+  }) {
+    final config = (enabled, targetFrameMs, minPressureIters, minParticleIters,
+        minThreads, maxThreads, mayDropSeparation, mayDropColoring, throttleTemperature);
+    if (config == _governorConfig) return;
+    _governorConfig = config;
+    _ffi.simSetGovernor(_ctx, enabled, targetFrameMs, minPressureIters, minParticleIters,
+        minThreads, maxThreads, mayDropSeparation, mayDropColoring, throttleTemperature);
+  }
+
+  /// Device temperature fed to the governor (below -900 means unknown).
+  set governorTemperature(double celsius) {
+    if (celsius == _governorTemperature) return;
+    _governorTemperature = celsius;
+    _ffi.simSetGovernorTemperature(_ctx, celsius);
+  }
+
+  Float32List _floatView(int bufferId, int length) =>
+      _ffi.simGetBuffer(_ctx, bufferId).cast<Float>().asTypedList(length);
+
+  void _bindLiveViews() {
+    particleX = _floatView(SimBuffer.particleX, maxParticles);
+    particleY = _floatView(SimBuffer.particleY, maxParticles);
+    particleGrade = _ffi.simGetBuffer(_ctx, SimBuffer.particleGrade).cast<Uint16>().asTypedList(maxParticles); // Initialised natively
+    particleDensity = _floatView(SimBuffer.particleDensity, fNumCells);
+    cellType = _ffi.simGetBuffer(_ctx, SimBuffer.cellType).cast<Int32>().asTypedList(fNumCells);
+    stageTimings = _floatView(SimBuffer.stageTimings, SimStage.count);
+    governorState = _floatView(SimBuffer.governorState, GovernorState.count);
+  }
+
+  /// Frames per second of the native simulation thread; 0 runs the simulation
+  /// synchronously inside [simulate]. While the thread runs, [simulate] only
+  /// hands it the latest parameters and switches the render-facing views to the
+  /// newest completed snapshot, never waiting for a frame.
+  double get backgroundStepsPerSecond => _backgroundStepsPerSecond;
+  set backgroundStepsPerSecond(double stepsPerSecond) {
+    if (stepsPerSecond == _backgroundStepsPerSecond) return;
+    if (_backgroundStepsPerSecond > 0.0) {
+      _ffi.simStopThread(_ctx);
+      _snapshotSlot = -1;
+      _bindLiveViews();
+    }
+    _backgroundStepsPerSecond = 0.0;
+    if (stepsPerSecond > 0.0) {
+      if (_ffi.simStartThread(_ctx, stepsPerSecond)) {
+        _backgroundStepsPerSecond = stepsPerSecond;
+        _snapshotViews.fillRange(0, _snapshotViews.length, null); // Buffers are reallocated on start
+      } else {
+        devLog.log("Failed to start the native simulation thread; stepping synchronously.", name: 'FlipFluidSim.Error');
       }
     }
+    devLog.log("Background simulation: ${_backgroundStepsPerSecond > 0.0 ? '$_backgroundStepsPerSecond steps/s' : 'off'}", name: 'FlipFluidSim');
+  }
+
+  // Points the render-facing views at the newest snapshot, if one was published.
+  void _acquireSnapshot() {
+    final int slot = _ffi.simAcquireSnapshot(_ctx);
+    if (slot < 0 || slot == _snapshotSlot) return;
+    _snapshotSlot = slot;
+    final views = _snapshotViews[slot] ??= _SnapshotViews(
+      particleX: _snapshotFloatView(slot, SimBuffer.particleX, maxParticles),
+      particleY: _snapshotFloatView(slot, SimBuffer.particleY, maxParticles),
+      particleGrade: _ffi.simGetSnapshotBuffer(_ctx, slot, SimBuffer.particleGrade).cast<Uint16>().asTypedList(maxParticles),
+      cellType: _ffi.simGetSnapshotBuffer(_ctx, slot, SimBuffer.cellType).cast<Int32>().asTypedList(fNumCells),
+      particleDensity: _snapshotFloatView(slot, SimBuffer.particleDensity, fNumCells),
+      stageTimings: _snapshotFloatView(slot, SimBuffer.stageTimings, SimStage.count),
+      info: _snapshotFloatView(slot, SimBuffer.snapshotInfo, SnapshotInfo.count),
+      governorState: _snapshotFloatView(slot, SimBuffer.governorState, GovernorState.count),
+    );
+    particleX = views.particleX;
+    particleY = views.particleY;
+    particleGrade = views.particleGrade;
+    cellType = views.cellType;
+    particleDensity = views.particleDensity;
+    stageTimings = views.stageTimings;
+    governorState = views.governorState;
+    particleRestDensity = views.info[SnapshotInfo.restDensity];
+    pressureIterations = views.info[SnapshotInfo.pressureIterations].toInt();
+    pressureResidual = views.info[SnapshotInfo.pressureResidual];
+    substeps = views.info[SnapshotInfo.substeps].toInt();
+  }
+
+  Float32List _snapshotFloatView(int slot, int bufferId, int length) =>
+      _ffi.simGetSnapshotBuffer(_ctx, slot, bufferId).cast<Float>().asTypedList(length);
+
+  // Resets the container mask and clears grid velocities and pressure (natively,
+  // so it is safe while the background thread runs).
+  void initializeGrid() {
+    _ffi.simResetGrid(_ctx);
   }
 
+
   void setObstacle(double x, double y, bool reset, double dt) {
     devLog.log(
         '[Sim.setObstacle] INPUT: x=$x, y=$y, reset=$reset, dt=$dt. Current obstacle: oldX=$obstacleX, oldY=$obstacleY, oldVelX=$obstacleVelX, oldVelY=$obstacleVelY, active=$isObstacleActive', name: 'FlipFluidSim');
@@ -447,182 +777,30 @@ class FlipFluidSimulation {
     devLog.log(
         '[Sim.setObstacle] UPDATED: obstacleX=$obstacleX, obstacleY=$obstacleY, obstacleVelX=$obstacleVelX, obstacleVelY=$obstacleVelY', name: 'FlipFluidSim');
 
-    final int n = fNumY;
-    final double mainRSq = sceneCircleRadius * sceneCircleRadius;
-    final double draggableRSq = this.obstacleRadius * this.obstacleRadius;
-
-    for (int i = 0; i < fNumX; i++) {
-      for (int j = 0; j < fNumY; j++) {
-        int idx = i * n + j;
-        double cellRealX = (i + 0.5) * h;
-        double cellRealY = (j + 0.5) * h;
-
-        double dxMain = cellRealX - sceneCircleCenterX;
-        double dyMain = cellRealY - sceneCircleCenterY;
-        double distSqToMainCenter = dxMain * dxMain + dyMain * dyMain;
-        
-        bool isStaticWall = distSqToMainCenter > mainRSq;
-
-        if (isStaticWall) {
-          s[idx] = 0.0;
-        } else {
-          s[idx] = 1.0;
-          if (this.isObstacleActive) {
-            double dxDrag = cellRealX - obstacleX;
-            double dyDrag = cellRealY - obstacleY;
-            double distSqToDraggableCenter = dxDrag * dxDrag + dyDrag * dyDrag;
-
-            if (i > fNumX / 2 - 2 && i < fNumX / 2 + 2 && j > fNumY / 2 - 2 && j < fNumY / 2 + 2 && (idx % 10 == 0)) {
-                 devLog.log('[Sim.setObstacle Loop] cell($i,$j) real($cellRealX,$cellRealY) vs obst($obstacleX,$obstacleY). distSq=$distSqToDraggableCenter, rSqLimit=$draggableRSq. s[$idx] before=${s[idx]}', name: 'FlipFluidSim.Loop');
-            }
-
-            if (distSqToDraggableCenter < draggableRSq) {
-              if (idx % 10 == 0) {
-                devLog.log('[Sim.setObstacle Loop] Cell ($i,$j) INSIDE obstacle. Setting s[$idx]=0.0. Applying vel: $obstacleVelX, $obstacleVelY', name: 'FlipFluidSim.Loop');
-              }
-              s[idx] = 0.0;
-              if (i < fNumX) u[idx] = obstacleVelX;
-              if (i + 1 < fNumX) u[(i + 1) * n + j] = obstacleVelX;
-              if (j < fNumY) v[idx] = obstacleVelY;
-              if (j + 1 < fNumY) v[i * n + (j + 1)] = obstacleVelY;
-            }
-          }
-        }
-      }
-    }
-  }
-
-  int _countParticlesForHeight(double testFillHeightFromBottom, int targetMaxCount) {
-    final dx = 2 * particleRadius;
-    final dy = math.sqrt(3.0) / 2 * dx;
-    if (dx <= 0 || dy <= 0) return 0;
-
-    final double actualCircleBottomEdgeY_count = sceneCircleCenterY - sceneCircleRadius;
-    final double waterSurfaceLineY_count = actualCircleBottomEdgeY_count + testFillHeightFromBottom;
-
-    final double iterationStartX = sceneCircleCenterX - sceneCircleRadius;
-    final double iterationStartY = sceneCircleCenterY - sceneCircleRadius;
-    final int numPotentialRows = (2 * sceneCircleRadius / dy).ceil() + 2;
-    final int numPotentialCols = (2 * sceneCircleRadius / dx).ceil() + 2;
-
-    int currentSimulatedParticles = 0;
-
-    for (int j = 0; j < numPotentialRows; j++) {
-      final double yj = iterationStartY + j * dy;
-      if (yj - particleRadius > sceneCircleCenterY + sceneCircleRadius && j > 0) break;
-
-      for (int i = 0; i < numPotentialCols; i++) {
-        if (currentSimulatedParticles >= targetMaxCount) return currentSimulatedParticles;
-
-        final double xi = iterationStartX + i * dx + (j.isOdd ? particleRadius : 0);
-        if (xi - particleRadius > sceneCircleCenterX + sceneCircleRadius && i > 0) break;
-        if (xi + particleRadius < sceneCircleCenterX - sceneCircleRadius) continue;
-
-        bool isInWaterRegion = yj < waterSurfaceLineY_count;
-        double dxCircle = xi - sceneCircleCenterX;
-        double dyCircle = yj - sceneCircleCenterY;
-        double distSqToCenter = dxCircle * dxCircle + dyCircle * dyCircle;
-        bool isInsideCircle = distSqToCenter < math.pow(sceneCircleRadius - particleRadius, 2).toDouble();
-
-        if (isInWaterRegion && isInsideCircle) {
-          currentSimulatedParticles++;
-        }
-      }
-    }
-    return currentSimulatedParticles;
+    _ffi.simSetObstacle(_ctx, isObstacleActive, obstacleX, obstacleY, obstacleRadius, obstacleVelX, obstacleVelY);
   }
 
+  /// Seeds a hex lattice of up to [maxCount] particles at the bottom of the
+  /// container. The water line search and the lattice fill run natively
+  /// (sim_seed_particles) and write straight into the particle buffers.
   void fillCircleBottom(double initialGuessFillHeightFromBottom, {int? maxCount}) {
     final int targetParticleCount = maxCount ?? this.maxParticles;
     if (targetParticleCount == 0) return;
 
-    final dx = 2 * particleRadius;
-    final dy = math.sqrt(3.0) / 2 * dx;
-
-    if (dx <= 0 || dy <= 0) {
-      devLog.log("Error: particleRadius ($particleRadius) results in non-positive dx ($dx) or dy ($dy) for particle placement.", name: 'FlipFluidSim.Error');
+    if (particleRadius <= 0) {
+      devLog.log("Error: particleRadius ($particleRadius) results in non-positive lattice spacing for particle placement.", name: 'FlipFluidSim.Error');
       return;
     }
 
-    double determinedFillHeight = 0;
-    int iterationSafetyNet = 0;
-    const int maxIterations = 100;
-    double heightStep = particleRadius;
-
-    double currentTestHeight = heightStep;
-    while(iterationSafetyNet < maxIterations) {
-      int potentialParticles = _countParticlesForHeight(currentTestHeight, targetParticleCount);
-      
-      if (potentialParticles >= targetParticleCount || currentTestHeight >= 2 * sceneCircleRadius) {
-        determinedFillHeight = currentTestHeight;
-        break;
-      }
-      currentTestHeight += heightStep;
-      iterationSafetyNet++;
-      if (iterationSafetyNet == maxIterations) {
-         devLog.log("Warning: Max iterations reached in fillCircleBottom height determination. Using currentTestHeight: $currentTestHeight", name: 'FlipFluidSim.Warning');
-         determinedFillHeight = currentTestHeight;
-      }
-    }
-    if (determinedFillHeight == 0 && initialGuessFillHeightFromBottom > 0) {
-        devLog.log("Warning: Dynamic height determination failed, using initial guess: $initialGuessFillHeightFromBottom", name: 'FlipFluidSim.Warning');
-        determinedFillHeight = initialGuessFillHeightFromBottom;
-    } else if (determinedFillHeight == 0) {
-        devLog.log("Error: Could not determine a valid fill height. Defaulting to a small portion.", name: 'FlipFluidSim.Error');
-        determinedFillHeight = sceneCircleRadius * 0.2;
-    }
-
-    final double actualCircleBottomEdgeY = sceneCircleCenterY - sceneCircleRadius;
-    final double waterSurfaceLineY = actualCircleBottomEdgeY + determinedFillHeight;
-
-    final double iterationStartX = sceneCircleCenterX - sceneCircleRadius;
-    final double iterationStartY = sceneCircleCenterY - sceneCircleRadius;
-    final int numPotentialRows = (2 * sceneCircleRadius / dy).ceil() + 2;
-    final int numPotentialCols = (2 * sceneCircleRadius / dx).ceil() + 2;
-
-    for (int j = 0; j < numPotentialRows; j++) {
-      final double yj = iterationStartY + j * dy;
-      if (yj - particleRadius > sceneCircleCenterY + sceneCircleRadius && j > 0) break;
-
-      for (int i = 0; i < numPotentialCols; i++) {
-        if (numParticles >= targetParticleCount || numParticles >= this.maxParticles) return;
-
-        final double xi = iterationStartX + i * dx + (j.isOdd ? particleRadius : 0);
-        if (xi - particleRadius > sceneCircleCenterX + sceneCircleRadius && i > 0) break;
-        if (xi + particleRadius < sceneCircleCenterX - sceneCircleRadius) continue;
-
-        bool isInWaterRegion = yj < waterSurfaceLineY;
-        double dxCircle = xi - sceneCircleCenterX;
-        double dyCircle = yj - sceneCircleCenterY;
-        double distSqToCenter = dxCircle * dxCircle + dyCircle * dyCircle;
-        bool isInsideCircle = distSqToCenter < math.pow(sceneCircleRadius - particleRadius, 2).toDouble();
-
-        if (isInWaterRegion && isInsideCircle) {
-          particlePos[2 * numParticles] = xi;
-          particlePos[2 * numParticles + 1] = yj;
-          particleVel[2 * numParticles] = 0.0;
-          particleVel[2 * numParticles + 1] = 0.0;
-          numParticles++;
-        }
-      }
-    }
-     devLog.log("fillCircleBottom completed. Target: $targetParticleCount, Actual: $numParticles, Determined Height: $determinedFillHeight", name: 'FlipFluidSim');
+    numParticles = _ffi.simSeedParticles(_ctx, targetParticleCount);
+    final double determinedFillHeight = _ffi.simGetSeedFillHeight(_ctx);
+    devLog.log("fillCircleBottom completed. Target: $targetParticleCount, Actual: $numParticles, Determined Height: $determinedFillHeight (initial guess $initialGuessFillHeightFromBottom)", name: 'FlipFluidSim');
   }
 
   double clamp(double x, double minVal, double maxVal) {
     return math.min(math.max(x, minVal), maxVal);
   }
 
-  void integrateParticles(double dt, double gravityX, double gravityY) {
-    for (int i = 0; i < numParticles; i++) {
-      final int b = 2 * i;
-      particleVel[b] += dt * gravityX; 
-      particleVel[b + 1] += dt * gravityY;
-      particlePos[b] += particleVel[b] * dt;
-      particlePos[b + 1] += particleVel[b + 1] * dt;
-    }
-  }
-
   void _setSciColor(int cellNr, double val, double minVal, double maxVal) {
     val = math.min(math.max(val, minVal), maxVal - 0.0001);
     double d = maxVal - minVal;
@@ -658,271 +836,59 @@ class FlipFluidSimulation {
     }
   }
 
-  void _stepOnce(double dt, double gX, double gY, double flipR, int pIters, int partIters, double oRelax, bool compDrift, bool sepParts) {
-    integrateParticles(dt, gX, gY);
-
-    if (sepParts) {
-      numCellParticles.fillRange(0, pNumCells, 0);
-      for (int i = 0; i < numParticles; i++) {
-        final double x = particlePos[2 * i], y = particlePos[2 * i + 1];
-        final int xi = clamp((x * pInvSpacing).floorToDouble(), 0, pNumX - 1).toInt();
-        final int yi = clamp((y * pInvSpacing).floorToDouble(), 0, pNumY - 1).toInt();
-        final int cellIdx = xi * pNumY + yi;
-        if (cellIdx >= 0 && cellIdx < pNumCells) numCellParticles[cellIdx]++;
-      }
-      int sum = 0;
-      for (int c = 0; c < pNumCells; c++) {
-        firstCellParticle[c] = sum;
-        sum += numCellParticles[c];
-      }
-      if (firstCellParticle.length > pNumCells) {
-        firstCellParticle[pNumCells] = sum;
-      } else {
-        devLog.log("Error: firstCellParticle array is too small for pushParticlesApart data prep!", name: 'FlipFluidSim.Error');
-      }
-
-      var currentCellIndices = Int32List(pNumCells);
-      for(int c=0; c < pNumCells; ++c) {
-          currentCellIndices[c] = firstCellParticle[c];
-      }
-
-      for (int i = 0; i < numParticles; i++) {
-        final double x = particlePos[2 * i], y = particlePos[2 * i + 1];
-        final int xi = clamp((x * pInvSpacing).floorToDouble(), 0, pNumX - 1).toInt();
-        final int yi = clamp((y * pInvSpacing).floorToDouble(), 0, pNumY - 1).toInt();
-        final int cellIdx = xi * pNumY + yi;
-        if (cellIdx >= 0 && cellIdx < pNumCells) {
-          int insertPos = currentCellIndices[cellIdx];
-          if (insertPos >= 0 && insertPos < cellParticleIds.length) {
-            cellParticleIds[insertPos] = i;
-            currentCellIndices[cellIdx]++;
-          } else {
-            devLog.log("Error: insertPos $insertPos out of bounds for cellParticleIds (len: ${cellParticleIds.length}) in pushParticlesApart data prep.", name: 'FlipFluidSim.Error');
-          }
-        }
-      }
-      final double minDist = 2.0 * particleRadius;
-      final double minDist2 = minDist * minDist;
-
-      try {
-        _nativeParticlePosPtr.asTypedList(particlePos.length).setAll(0, particlePos);
-        _nativeFirstCellParticlePtr.asTypedList(firstCellParticle.length).setAll(0, firstCellParticle);
-        _nativeCellParticleIdsPtr.asTypedList(cellParticleIds.length).setAll(0, cellParticleIds);
-
-        _ffi.pushParticlesApart(
-            _nativeParticlePosPtr, 
-            _nativeFirstCellParticlePtr, 
-            _nativeCellParticleIdsPtr,
-            numParticles, pNumX, pNumY, pInvSpacing, partIters, particleRadius, minDist2
-        );
-
-        particlePos.setAll(0, _nativeParticlePosPtr.asTypedList(particlePos.length));
-      } catch (e) { devLog.log("Error during FFI call/copy for pushParticlesApart: $e", name: 'FlipFluidSim.FFIError'); }
-    }
-
-    if (sepParts && this.enableDynamicColoring) {
-      try {
-        _nativeParticleColorPtr.asTypedList(particleColor.length).setAll(0, particleColor);
-        
-        double colorDiffusionCoefficient = 0.001;
-
-        _ffi.diffuseParticleColors(
-            _nativeParticlePosPtr, // Assumed to be up-to-date in native memory from pushParticlesApart
-            _nativeParticleColorPtr,
-            _nativeFirstCellParticlePtr, // Assumed to be up-to-date from pushParticlesApart
-            _nativeCellParticleIdsPtr,   // Assumed to be up-to-date from pushParticlesApart
-            numParticles,
-            pNumX, pNumY,
-            pInvSpacing,
-            particleRadius,
-            this.enableDynamicColoring,
-            colorDiffusionCoefficient
-        );
-        
-        particleColor.setAll(0, _nativeParticleColorPtr.asTypedList(particleColor.length));
-
-      } catch (e) { devLog.log("Error during FFI call/copy for diffuseParticleColors: $e", name: 'FlipFluidSim.FFIError'); }
+  void _stepFrame(double frameDt, int maxSubsteps, double cfl, double gX, double gY, double flipR, int pIters, int partIters, double oRelax, bool compDrift, bool sepParts) {
+    bool obstDataChanged = isObstacleActive != _lastLoggedObstActiveForStep ||
+                           obstacleX != _lastLoggedObstXForStep ||
+                           obstacleY != _lastLoggedObstYForStep ||
+                           obstacleRadius != _lastLoggedObstRForStep ||
+                           obstacleVelX != _lastLoggedObstVelXForStep ||
+                           obstacleVelY != _lastLoggedObstVelYForStep;
+
+    if (obstDataChanged) {
+      devLog.log(
+          '[Sim._stepFrame Pre-FFI.simStepFrame] obstActive=$isObstacleActive, obstX=$obstacleX, obstY=$obstacleY, obstR=$obstacleRadius, obstVelX=$obstacleVelX, obstVelY=$obstacleVelY', name: 'FlipFluidSim');
+      _lastLoggedObstActiveForStep = isObstacleActive;
+      _lastLoggedObstXForStep = obstacleX;
+      _lastLoggedObstYForStep = obstacleY;
+      _lastLoggedObstRForStep = obstacleRadius;
+      _lastLoggedObstVelXForStep = obstacleVelX;
+      _lastLoggedObstVelYForStep = obstacleVelY;
     }
 
     try {
-      _nativeParticlePosPtr.asTypedList(particlePos.length).setAll(0, particlePos);
-      _nativeParticleVelPtr.asTypedList(particleVel.length).setAll(0, particleVel);
-
-      bool obstDataChangedForCollisions = isObstacleActive != _lastLoggedObstActiveForCollisions ||
-                                          obstacleX != _lastLoggedObstXForCollisions ||
-                                          obstacleY != _lastLoggedObstYForCollisions ||
-                                          obstacleRadius != _lastLoggedObstRForCollisions ||
-                                          obstacleVelX != _lastLoggedObstVelXForCollisions ||
-                                          obstacleVelY != _lastLoggedObstVelYForCollisions;
-
-      if (obstDataChangedForCollisions) {
-        devLog.log(
-            '[Sim._stepOnce Pre-FFI.handleCollisions] obstActive=$isObstacleActive, obstX=$obstacleX, obstY=$obstacleY, obstR=$obstacleRadius, obstVelX=$obstacleVelX, obstVelY=$obstacleVelY', name: 'FlipFluidSim');
-        _lastLoggedObstActiveForCollisions = isObstacleActive;
-        _lastLoggedObstXForCollisions = obstacleX;
-        _lastLoggedObstYForCollisions = obstacleY;
-        _lastLoggedObstRForCollisions = obstacleRadius;
-        _lastLoggedObstVelXForCollisions = obstacleVelX;
-        _lastLoggedObstVelYForCollisions = obstacleVelY;
-      }
-      _ffi.handleCollisions(
-          _nativeParticlePosPtr, _nativeParticleVelPtr,
-          numParticles, particleRadius,
+      substeps = _ffi.simStepFrame(
+          _ctx, numParticles,
+          frameDt, maxSubsteps, cfl, gX, gY, flipR,
+          pIters, partIters, oRelax,
+          compDrift, sepParts,
           isObstacleActive, obstacleX, obstacleY, obstacleRadius,
-          obstacleVelX, obstacleVelY,
-          sceneCircleCenterX, sceneCircleCenterY, sceneCircleRadius
-      );
-
-      particlePos.setAll(0, _nativeParticlePosPtr.asTypedList(particlePos.length));
-      particleVel.setAll(0, _nativeParticleVelPtr.asTypedList(particleVel.length));
-    } catch (e) { devLog.log("Error during FFI call/copy for handleCollisions: $e", name: 'FlipFluidSim.FFIError'); }
-
-    try {
-      _nativeUPtr.asTypedList(u.length).setAll(0, u);
-      _nativeVPtr.asTypedList(v.length).setAll(0, v);
-      _nativeSPtr.asTypedList(s.length).setAll(0, s);
-      _nativeParticlePosPtr.asTypedList(particlePos.length).setAll(0, particlePos);
-      _nativeParticleVelPtr.asTypedList(particleVel.length).setAll(0, particleVel);
-
-      _ffi.transferVelocities(
-          true, flipR,
-          _nativeUPtr, _nativeVPtr, _nativeDuPtr, _nativeDvPtr,
-          _nativePrevUPtr, _nativePrevVPtr,
-          _nativeCellTypePtr,
-          _nativeSPtr,
-          _nativeParticlePosPtr,
-          _nativeParticleVelPtr,
-          fNumX, fNumY, h, fInvSpacing,
-          numParticles
-      );
-
-      u.setAll(0, _nativeUPtr.asTypedList(u.length));
-      v.setAll(0, _nativeVPtr.asTypedList(v.length));
-      du.setAll(0, _nativeDuPtr.asTypedList(du.length));
-      dv.setAll(0, _nativeDvPtr.asTypedList(dv.length));
-      prevU.setAll(0, _nativePrevUPtr.asTypedList(prevU.length));
-      prevV.setAll(0, _nativePrevVPtr.asTypedList(prevV.length));
-      cellType.setAll(0, _nativeCellTypePtr.asTypedList(cellType.length));
-
-    } catch (e) { devLog.log("Error during FFI call/copy for transferVelocities(toGrid=true): $e", name: 'FlipFluidSim.FFIError'); }
-
-    try {
-      // Update particle density grid (always done)
-      _nativeParticlePosPtr.asTypedList(particlePos.length).setAll(0, particlePos);
-
-      _ffi.updateParticleDensityGrid( // Renamed
-          numParticles, particleRestDensity, fInvSpacing,
-          fNumX, fNumY, h,
-          _nativeParticlePosPtr,
-          _nativeParticleDensityPtr
-      );
-      particleDensity.setAll(0, _nativeParticleDensityPtr.asTypedList(particleDensity.length));
-
-      // Conditionally update particle colors
-      if (this.enableDynamicColoring) {
-        _nativeParticleColorPtr.asTypedList(particleColor.length).setAll(0, particleColor);
-        // particlePos and particleDensityGrid are already in native memory from the previous call or earlier steps.
-
-        _ffi.updateDynamicParticleColors(
-            numParticles, particleRestDensity, fInvSpacing,
-            fNumX, fNumY, h,
-            _nativeParticlePosPtr,
-            _nativeParticleDensityPtr,
-            _nativeParticleColorPtr
-        );
-        particleColor.setAll(0, _nativeParticleColorPtr.asTypedList(particleColor.length));
-      }
-
-      if (particleRestDensity == 0.0) {
-        double sum = 0.0;
-        int count = 0;
-        for (int i = 0; i < fNumCells; i++) {
-          if (cellType[i] == FLUID_CELL) {
-            sum += particleDensity[i];
-            count++;
-          }
-        }
-        if (count > 0) particleRestDensity = sum / count;
-      }
-
-    } catch (e) { devLog.log("Error during FFI call/copy for updateParticleProperties: $e", name: 'FlipFluidSim.FFIError'); }
-
-    try {
-      p.fillRange(0, p.length, 0.0); 
-
-      prevU.setAll(0, u);
-      prevV.setAll(0, v);
-
-      _nativeUPtr.asTypedList(u.length).setAll(0, u);
-      _nativeVPtr.asTypedList(v.length).setAll(0, v);
-      _nativePPtr.asTypedList(p.length).setAll(0, p);
-      _nativeSPtr.asTypedList(s.length).setAll(0, s);
-      _nativeCellTypePtr.asTypedList(cellType.length).setAll(0, cellType);
-      _nativeParticleDensityPtr.asTypedList(particleDensity.length).setAll(0, particleDensity);
-      
-      bool obstDataChangedForSolveIncompressibility = isObstacleActive != _lastLoggedObstActiveForSolveIncompressibility ||
-                                                      obstacleX != _lastLoggedObstXForSolveIncompressibility ||
-                                                      obstacleY != _lastLoggedObstYForSolveIncompressibility ||
-                                                      obstacleRadius != _lastLoggedObstRForSolveIncompressibility ||
-                                                      obstacleVelX != _lastLoggedObstVelXForSolveIncompressibility ||
-                                                      obstacleVelY != _lastLoggedObstVelYForSolveIncompressibility;
-
-      if (obstDataChangedForSolveIncompressibility) {
-        devLog.log(
-            '[Sim._stepOnce Pre-FFI.solveIncompressibility] obstActive=$isObstacleActive, obstX=$obstacleX, obstY=$obstacleY, obstR=$obstacleRadius, obstVelX=$obstacleVelX, obstVelY=$obstacleVelY', name: 'FlipFluidSim');
-        _lastLoggedObstActiveForSolveIncompressibility = isObstacleActive;
-        _lastLoggedObstXForSolveIncompressibility = obstacleX;
-        _lastLoggedObstYForSolveIncompressibility = obstacleY;
-        _lastLoggedObstRForSolveIncompressibility = obstacleRadius;
-        _lastLoggedObstVelXForSolveIncompressibility = obstacleVelX;
-        _lastLoggedObstVelYForSolveIncompressibility = obstacleVelY;
-      }
-      _ffi.solveIncompressibility(
-          _nativeUPtr, _nativeVPtr, _nativePPtr, _nativeSPtr, _nativeCellTypePtr,
-          _nativeParticleDensityPtr, fNumX, fNumY, pIters, h, dt, density, oRelax,
-          particleRestDensity, compDrift, sceneCircleCenterX, sceneCircleCenterY,
-          sceneCircleRadius, this.isObstacleActive, this.obstacleX, this.obstacleY,
-          this.obstacleRadius, this.obstacleVelX, this.obstacleVelY);
-
-       u.setAll(0, _nativeUPtr.asTypedList(u.length));
-       v.setAll(0, _nativeVPtr.asTypedList(v.length));
-       p.setAll(0, _nativePPtr.asTypedList(p.length));
-
-    } catch (e) { devLog.log("Error during FFI call/copy for solveIncompressibility: $e", name: 'FlipFluidSim.FFIError'); }
-
-    try {
-      _nativeUPtr.asTypedList(u.length).setAll(0, u);
-      _nativeVPtr.asTypedList(v.length).setAll(0, v);
-      _nativePrevUPtr.asTypedList(prevU.length).setAll(0, prevU);
-      _nativePrevVPtr.asTypedList(prevV.length).setAll(0, prevV);
-      _nativeCellTypePtr.asTypedList(cellType.length).setAll(0, cellType);
-      _nativeSPtr.asTypedList(s.length).setAll(0, s);
-      _nativeParticlePosPtr.asTypedList(particlePos.length).setAll(0, particlePos);
-      _nativeParticleVelPtr.asTypedList(particleVel.length).setAll(0, particleVel);
-
-      _ffi.transferVelocities(
-          false, flipR,
-          _nativeUPtr, _nativeVPtr, _nativeDuPtr, _nativeDvPtr,
-          _nativePrevUPtr, _nativePrevVPtr,
-          _nativeCellTypePtr,
-          _nativeSPtr,
-          _nativeParticlePosPtr,
-          _nativeParticleVelPtr,
-          fNumX, fNumY, h, fInvSpacing,
-          numParticles
-      );
-
-      particleVel.setAll(0, _nativeParticleVelPtr.asTypedList(particleVel.length));
-
-    } catch (e) { devLog.log("Error during FFI call/copy for transferVelocities(toGrid=false): $e", name: 'FlipFluidSim.FFIError'); }
+          obstacleVelX, obstacleVelY);
+      particleRestDensity = _ffi.simGetParticleRestDensity(_ctx);
+      pressureIterations = _ffi.simGetPressureIterations(_ctx);
+      pressureResidual = _ffi.simGetPressureResidual(_ctx);
+    } catch (e) { devLog.log("Error during FFI call for simStepFrame: $e", name: 'FlipFluidSim.FFIError'); }
   }
 
+  // Advances by dt, split natively into CFL-limited substeps (at most maxSubsteps,
+  // each moving particles at most cflNumber cells).
   void simulate({
-    required double dt, required double gravityX, required double gravityY,
+    required double dt, int maxSubsteps = 1, double cflNumber = 1.0, required double gravityX, required double gravityY,
     required double flipRatio, required int numPressureIters, required int numParticleIters,
     required double overRelaxation, required bool compensateDrift, required bool separateParticles,
   }) {
-    _stepOnce(dt, gravityX, gravityY, flipRatio, numPressureIters, numParticleIters,
+    if (_backgroundStepsPerSecond > 0.0) {
+      _ffi.simSetFrameParams(
+          _ctx, numParticles,
+          dt, maxSubsteps, cflNumber, gravityX, gravityY, flipRatio,
+          numPressureIters, numParticleIters, overRelaxation,
+          compensateDrift, separateParticles,
+          isObstacleActive, obstacleX, obstacleY, obstacleRadius,
+          obstacleVelX, obstacleVelY);
+      _acquireSnapshot();
+      updateCellColors();
+      return;
+    }
+    _stepFrame(dt, maxSubsteps, cflNumber, gravityX, gravityY, flipRatio, numPressureIters, numParticleIters,
               overRelaxation, compensateDrift, separateParticles);
     updateCellColors();
   }
@@ -930,14 +896,21 @@ class FlipFluidSimulation {
   void dispose() {
     devLog.log("Disposing FlipFluidSimulation...", name: 'FlipFluidSim');
     try {
-      ffiMemory.calloc.free(_nativeUPtr); ffiMemory.calloc.free(_nativeVPtr); ffiMemory.calloc.free(_nativePPtr);
-      ffiMemory.calloc.free(_nativeSPtr); ffiMemory.calloc.free(_nativeCellTypePtr);
-      ffiMemory.calloc.free(_nativeParticleDensityPtr); ffiMemory.calloc.free(_nativeParticlePosPtr);
-      ffiMemory.calloc.free(_nativeFirstCellParticlePtr); ffiMemory.calloc.free(_nativeCellParticleIdsPtr);
-      ffiMemory.calloc.free(_nativeDuPtr); ffiMemory.calloc.free(_nativeDvPtr); ffiMemory.calloc.free(_nativePrevUPtr);
-      ffiMemory.calloc.free(_nativePrevVPtr); ffiMemory.calloc.free(_nativeParticleVelPtr);
-      ffiMemory.calloc.free(_nativeParticleColorPtr);
-     devLog.log("Native buffers freed.", name: 'FlipFluidSim');
-    } catch (e) { devLog.log("Error freeing native buffers: $e", name: 'FlipFluidSim.Error'); }
+      _ffi.simDestroy(_ctx);
+      devLog.log("Native context freed.", name: 'FlipFluidSim');
+    } catch (e) { devLog.log("Error freeing native context: $e", name: 'FlipFluidSim.Error'); }
   }
-}
\ No newline at end of file
+}
+
+// Typed views onto one native snapshot slot.
+class _SnapshotViews {
+  final Float32List particleX, particleY, particleDensity, stageTimings, info, governorState;
+  final Uint16List particleGrade;
+  final Int32List cellType;
+
+  _SnapshotViews({
+    required this.particleX, required this.particleY, required this.particleGrade,
+    required this.cellType, required this.particleDensity, required this.stageTimings,
+    required this.info, required this.governorState,
+  });
+}
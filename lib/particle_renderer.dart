@@ -144,25 +144,18 @@ class ParticleRenderer extends CustomPainter {
         final Map<Color, List<Offset>> particlePointsByColor = {};
 
         for (int i = 0; i < particleCount; i++) {
-          final double px = sim.particlePos[2 * i];
-          final double py = sim.particlePos[2 * i + 1];
-          final int colorIndex = 4 * i; // Changed for RGBA
-
-          final double rFloat = sim.particleColor[colorIndex];
-          final double gFloat = sim.particleColor[colorIndex + 1];
-          final double bFloat = sim.particleColor[colorIndex + 2];
-          final double aFloat = sim.particleColor[colorIndex + 3]; // Alpha component
+          final double px = sim.particleX[i];
+          final double py = sim.particleY[i];
+          final double grade = sim.particleGrade[i] / FlipFluidSimulation.gradeScale;
 
           // New color logic: interpolate between particleDeepBlue and gridCellBlue
           // Define the two main colors for interpolation
           final Color deepBlue = Colors.blueAccent[700] ?? Colors.blueAccent; // Opaque Dark Blue
           final Color surfaceBlue = Colors.blueAccent[100] ?? Colors.blueAccent; // Color(0xFFADD8E6) -> (173, 216, 230)
 
-          // Assume rFloat (from sim.particleColor[colorIndex]) is the primary factor for interpolation (0.0 to 1.0).
+          // The grade (0.0 to 1.0) is the interpolation factor.
           // This 'interpolationFactorRaw' corresponds to 'alpha' in the user's formula before quantization.
-          double interpolationFactorRaw = rFloat; // Using rFloat as the source for the grade.
-                                                 // Consider if gFloat, bFloat, or an average might be more suitable
-                                                 // depending on how sim.particleColor stores the "grade".
+          double interpolationFactorRaw = grade;
 
           // Quantization of interpolationFactorRaw
           const int numColorBuckets = 5; // Example: 5 buckets means 5 distinct colors.
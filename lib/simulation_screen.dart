@@ -382,6 +382,10 @@ void _startClockTimer() {
      setState(() {
         _currentConfigName = configName;
         simOptions.timeScale = (config['timeScale'] as num?)?.toDouble() ?? simOptions.timeScale;
+        simOptions.maxSubsteps = (config['maxSubsteps'] as int?) ?? simOptions.maxSubsteps;
+        simOptions.backgroundSimulation = (config['backgroundSimulation'] as bool?) ?? simOptions.backgroundSimulation;
+        simOptions.backgroundStepsPerSecond = (config['backgroundStepsPerSecond'] as num?)?.toDouble() ?? simOptions.backgroundStepsPerSecond;
+        simOptions.cflNumber = (config['cflNumber'] as num?)?.toDouble() ?? simOptions.cflNumber;
         simOptions.overRelax = (config['overRelax'] as num?)?.toDouble() ?? simOptions.overRelax;
         simOptions.flipRatio = (config['flipRatio'] as num?)?.toDouble() ?? simOptions.flipRatio;
         simOptions.showParticles = (config['showParticles'] as bool?) ?? simOptions.showParticles;
@@ -390,6 +394,24 @@ void _startClockTimer() {
         simOptions.separateParticles = (config['separateParticles'] as bool?) ?? simOptions.separateParticles;
         simOptions.pressureIters = (config['pressureIters'] as int?) ?? simOptions.pressureIters;
         simOptions.particleIters = (config['particleIters'] as int?) ?? simOptions.particleIters;
+        simOptions.pressureSolver = (config['pressureSolver'] as int?) ?? simOptions.pressureSolver;
+        simOptions.pressureTolerance = (config['pressureTolerance'] as num?)?.toDouble() ?? simOptions.pressureTolerance;
+        simOptions.pressureCheckInterval = (config['pressureCheckInterval'] as int?) ?? simOptions.pressureCheckInterval;
+        simOptions.pressureWarmStart = (config['pressureWarmStart'] as bool?) ?? simOptions.pressureWarmStart;
+        simOptions.particleReorderInterval = (config['particleReorderInterval'] as int?) ?? simOptions.particleReorderInterval;
+        simOptions.particleSeparationMode = (config['particleSeparationMode'] as int?) ?? simOptions.particleSeparationMode;
+        simOptions.threadBudget = (config['threadBudget'] as int?) ?? simOptions.threadBudget;
+        simOptions.threadAffinity = (config['threadAffinity'] as int?) ?? simOptions.threadAffinity;
+        simOptions.threadSpinMillis = (config['threadSpinMillis'] as int?) ?? simOptions.threadSpinMillis;
+        simOptions.governorEnabled = (config['governorEnabled'] as bool?) ?? simOptions.governorEnabled;
+        simOptions.governorTargetFrameMs = (config['governorTargetFrameMs'] as num?)?.toDouble() ?? simOptions.governorTargetFrameMs;
+        simOptions.governorMinPressureIters = (config['governorMinPressureIters'] as int?) ?? simOptions.governorMinPressureIters;
+        simOptions.governorMinParticleIters = (config['governorMinParticleIters'] as int?) ?? simOptions.governorMinParticleIters;
+        simOptions.governorMinThreads = (config['governorMinThreads'] as int?) ?? simOptions.governorMinThreads;
+        simOptions.governorMaxThreads = (config['governorMaxThreads'] as int?) ?? simOptions.governorMaxThreads;
+        simOptions.governorMayDropSeparation = (config['governorMayDropSeparation'] as bool?) ?? simOptions.governorMayDropSeparation;
+        simOptions.governorMayDropColoring = (config['governorMayDropColoring'] as bool?) ?? simOptions.governorMayDropColoring;
+        simOptions.governorThrottleTemperature = (config['governorThrottleTemperature'] as num?)?.toDouble() ?? simOptions.governorThrottleTemperature;
         simOptions.particleCount = (config['particleCount'] as int?) ?? simOptions.particleCount;
         simOptions.obstacleRadius = (config['obstacleRadius'] as num?)?.toDouble() ?? simOptions.obstacleRadius;
         simOptions.particleRadiusRatio = (config['particleRadiusRatio'] as num?)?.toDouble() ?? simOptions.particleRadiusRatio;
@@ -502,7 +524,11 @@ void _startClockTimer() {
   DateTime _lastTimestamp = DateTime.now();
 
   void _onTick(Duration elapsed) {
-    if (!running || !_isInitialized) return;
+    if (!_isInitialized) return;
+    // The native thread only runs while the simulation is playing
+    sim.backgroundStepsPerSecond =
+        running && simOptions.backgroundSimulation ? simOptions.backgroundStepsPerSecond : 0.0;
+    if (!running) return;
 
     final now = DateTime.now();
     final delta = now.difference(_lastTimestamp);
@@ -522,8 +548,28 @@ void _startClockTimer() {
 
     final dtSim = simOptions.timeScale * (1/60.0);
 
+    sim.pressureSolver = simOptions.pressureSolver;
+    sim.setPressureTolerance(simOptions.pressureTolerance, simOptions.pressureCheckInterval);
+    sim.pressureWarmStart = simOptions.pressureWarmStart;
+    sim.reorderInterval = simOptions.particleReorderInterval;
+    sim.separationMode = simOptions.particleSeparationMode;
+    sim.setThreadConfig(simOptions.threadBudget, simOptions.threadAffinity, simOptions.threadSpinMillis);
+    sim.setGovernor(
+      enabled: simOptions.governorEnabled,
+      targetFrameMs: simOptions.governorTargetFrameMs,
+      minPressureIters: simOptions.governorMinPressureIters,
+      minParticleIters: simOptions.governorMinParticleIters,
+      minThreads: simOptions.governorMinThreads,
+      maxThreads: simOptions.governorMaxThreads,
+      mayDropSeparation: simOptions.governorMayDropSeparation,
+      mayDropColoring: simOptions.governorMayDropColoring,
+      throttleTemperature: simOptions.governorThrottleTemperature,
+    );
+    sim.governorTemperature = _temperature;
     sim.simulate(
       dt: dtSim,
+      maxSubsteps: simOptions.maxSubsteps,
+      cflNumber: simOptions.cflNumber,
       gravityX: simGx,
       gravityY: simGy,
       flipRatio: simOptions.flipRatio,
@@ -870,6 +916,34 @@ void _startClockTimer() {
                                 : 'T: ${_temperature.toStringAsFixed(1)}°C',
                             style: TextStyle(color: (isNight ? Colors.white : Colors.black).withOpacity(0.7), fontSize: 12),
                           ),
+                          SizedBox(height: 2),
+                          Text(
+                            sim.pressureResidual < 0
+                                ? 'P: ${sim.pressureIterations} it, ${sim.substeps} sub'
+                                : 'P: ${sim.pressureIterations} it, r=${sim.pressureResidual.toStringAsExponential(1)}, ${sim.substeps} sub',
+                            style: TextStyle(color: (isNight ? Colors.white : Colors.black).withOpacity(0.7), fontSize: 12),
+                          ),
+                          SizedBox(height: 2),
+                          Text(
+                            'ms P2G ${sim.stageTimings[SimStage.p2g].toStringAsFixed(2)}'
+                            ' G2P ${sim.stageTimings[SimStage.g2p].toStringAsFixed(2)}'
+                            ' push ${sim.stageTimings[SimStage.pushApart].toStringAsFixed(2)}'
+                            ' step ${sim.stageTimings[SimStage.total].toStringAsFixed(2)}',
+                            style: TextStyle(color: (isNight ? Colors.white : Colors.black).withOpacity(0.7), fontSize: 12),
+                          ),
+                          if (simOptions.governorEnabled) ...[
+                            SizedBox(height: 2),
+                            Text(
+                              'Gov ${sim.governorState[GovernorState.smoothedMs].toStringAsFixed(1)}'
+                              '/${sim.governorState[GovernorState.budgetMs].toStringAsFixed(1)} ms'
+                              ' P${sim.governorState[GovernorState.pressureIters].toInt()}'
+                              ' S${sim.governorState[GovernorState.particleIters].toInt()}'
+                              '${sim.governorState[GovernorState.separation] > 0 ? '' : ' nosep'}'
+                              '${sim.governorState[GovernorState.coloring] > 0 ? '' : ' nocol'}'
+                              ' T${sim.governorState[GovernorState.threads].toInt()}',
+                              style: TextStyle(color: (isNight ? Colors.white : Colors.black).withOpacity(0.7), fontSize: 12),
+                            ),
+                          ],
                         ],
                       ),
                     ),
@@ -906,6 +980,10 @@ class SimOptions {
   SimulationConfig simulationConfig;
 
   double timeScale = 1.0;
+  int maxSubsteps = 4; // Upper bound on CFL substeps per frame
+  double cflNumber = 1.0; // Max cells a particle may travel per substep
+  bool backgroundSimulation = false; // Step on a native thread; the UI renders the latest snapshot
+  double backgroundStepsPerSecond = 60.0;
   double overRelax = 1.9;
   double flipRatio = 0.9;
   bool showParticles = true;
@@ -914,6 +992,26 @@ class SimOptions {
   bool separateParticles = true;
   int pressureIters = 30;
   int particleIters = 2;
+  int pressureSolver = PressureSolver.gaussSeidel;
+  double pressureTolerance = 0.0; // Max divergence for early exit; 0 = run all pressureIters
+  int pressureCheckInterval = 5;
+  bool pressureWarmStart = false;
+  int particleReorderInterval = 0; // Frames between spatial sorts of the particle arrays; 0 = off
+  int particleSeparationMode = SeparationMode.gaussSeidel;
+  int threadBudget = 2; // Native worker threads; <= 0 uses every core
+  int threadAffinity = ThreadAffinity.any;
+  int threadSpinMillis = -1; // Worker spin before parking; < 0 keeps the OpenMP default
+  // Adaptive quality: pressureIters / particleIters / separateParticles / enableDynamicColoring
+  // become upper bounds that the native governor trades down to stay within the frame budget
+  bool governorEnabled = false;
+  double governorTargetFrameMs = 8.0;
+  int governorMinPressureIters = 10;
+  int governorMinParticleIters = 1;
+  int governorMinThreads = 1;
+  int governorMaxThreads = 2;
+  bool governorMayDropSeparation = true;
+  bool governorMayDropColoring = true;
+  double governorThrottleTemperature = 40.0; // Degrees C
   int particleCount = 1500;
   double obstacleRadius = 0.15;
   double particleRadiusRatio = 0.3;
@@ -0,0 +1,86 @@
+// Steps a fixed sloshing scene through the public C API and prints the mean
+// per-stage timings (SIM_BUFFER_STAGE_TIMINGS), once with particle reordering
+// off and once with the given reorder interval.
+//
+//   sim_benchmark [frames=600] [particles=15000] [cellsWide=100] [reorderInterval=10] [threads=2]
+//
+// Build with -DSIMULATION_NATIVE_BENCHMARK=ON (see src/CMakeLists.txt).
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "../simulation_native.h"
+
+namespace {
+
+// Indexed by SimStage
+const char* const STAGE_NAMES[] = {
+    "integrate", "particle grid", "reorder", "push apart", "color diffusion",
+    "collisions", "p2g", "density", "pressure", "g2p", "total",
+};
+const int STAGE_COUNT = SIM_STAGE_COUNT;
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == SIM_STAGE_COUNT, "one name per SimStage");
+const int WARMUP_FRAMES = 60;
+
+struct BenchConfig {
+    int frames = 600;
+    int particles = 15000;
+    int cellsWide = 100;
+    int threads = 2;
+};
+
+// Mean stage times (ms) over the measured frames of one run
+std::vector<double> runScene(const BenchConfig& cfg, int reorderInterval) {
+    const SimWorld world = simWorld(4.0, 4.0, cfg.cellsWide);
+    SimContext* ctx = simCreateWorld(world, cfg.particles);
+    std::vector<double> mean(STAGE_COUNT, 0.0);
+    if (ctx == nullptr) return mean;
+    sim_set_thread_config(ctx, cfg.threads, THREAD_AFFINITY_ANY, -1);
+    sim_set_pressure_solver(ctx, PRESSURE_SOLVER_RED_BLACK_SOR);
+    sim_set_separation_mode(ctx, SEPARATION_JACOBI);
+    sim_set_reorder_interval(ctx, reorderInterval);
+    const int numParticles = sim_seed_particles(ctx, cfg.particles);
+    const float* timings = static_cast<const float*>(sim_get_buffer(ctx, SIM_BUFFER_STAGE_TIMINGS));
+
+    for (int frame = 0; frame < WARMUP_FRAMES + cfg.frames; ++frame) {
+        // Tilt gravity every second so the particles keep mixing
+        const float gravityX = (frame / 60) % 2 ? 6.0f : -6.0f;
+        const float angle = frame * 0.05f;
+        sim_step(ctx, numParticles, 1.0f / 60.0f, gravityX, -9.81f, 0.9f, 50, 2, 1.9f, true, true,
+                 true, world.centerX + 0.5f * world.radius * std::cos(angle),
+                 world.centerY + 0.5f * world.radius * std::sin(angle), 0.15f * world.radius, 0.0f, 0.0f);
+        if (frame < WARMUP_FRAMES) continue;
+        for (int k = 0; k < STAGE_COUNT; ++k) mean[k] += timings[k];
+    }
+    for (double& t : mean) t /= cfg.frames;
+    sim_destroy(ctx);
+    return mean;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig cfg;
+    int reorderInterval = 10;
+    if (argc > 1) cfg.frames = std::max(1, atoi(argv[1]));
+    if (argc > 2) cfg.particles = std::max(1, atoi(argv[2]));
+    if (argc > 3) cfg.cellsWide = std::max(8, atoi(argv[3]));
+    if (argc > 4) reorderInterval = std::max(1, atoi(argv[4]));
+    if (argc > 5) cfg.threads = atoi(argv[5]);
+
+    printf("%d frames (+%d warm-up), %d particles, %d cells wide, %d threads\n",
+           cfg.frames, WARMUP_FRAMES, cfg.particles, cfg.cellsWide, cfg.threads);
+    const std::vector<double> base = runScene(cfg, 0);
+    const std::vector<double> sorted = runScene(cfg, reorderInterval);
+    char sortedLabel[32];
+    snprintf(sortedLabel, sizeof(sortedLabel), "reorder %d", reorderInterval);
+    printf("%-16s %12s %12s %8s\n", "stage (ms)", "no reorder", sortedLabel, "change");
+    for (int k = 0; k < STAGE_COUNT; ++k) {
+        const double change = base[k] > 1e-6 ? 100.0 * (sorted[k] - base[k]) / base[k] : 0.0;
+        printf("%-16s %12.3f %12.3f %7.1f%%\n", STAGE_NAMES[k], base[k], sorted[k], change);
+    }
+    return 0;
+}
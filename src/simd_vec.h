@@ -0,0 +1,331 @@
+// Thin fixed-width SIMD layer used by the kernels in simulation_native.cpp.
+//
+// One backend is picked at compile time:
+//   NEON    __ARM_NEON (arm64-v8a, armeabi-v7a)
+//   SSE     __SSE2__ (x86 / x86_64 desktop and emulator ABIs); SSE4.1 integer
+//           ops and AVX/AVX2 float8 + gather are used when the compiler enables them
+//   scalar  everything else, or when SIM_SIMD_SCALAR is defined
+//
+// The operations mirror the NEON intrinsics the kernels were written against, so
+// the NEON backend emits the same instructions as before. madd / msub are a
+// separate multiply and add on every backend (vmlaq semantics, never fused).
+// Only the reciprocal / rsqrt estimates differ in precision between backends;
+// callers always refine them with the matching Newton steps.
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if !defined(SIM_SIMD_SCALAR) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define SIM_SIMD_NEON 1
+#include <arm_neon.h>
+#elif !defined(SIM_SIMD_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SIM_SIMD_SSE 1
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIM_SIMD_AVX 1
+#endif
+#else
+#define SIM_SIMD_SCALAR_BACKEND 1
+#endif
+
+namespace simd {
+
+#if defined(SIM_SIMD_NEON)
+
+using float4 = float32x4_t;
+using int4 = int32x4_t;
+using mask4 = uint32x4_t; // All-ones / all-zeros lanes
+using u16x8 = uint16x8_t;
+
+inline float4 load(const float* p) { return vld1q_f32(p); }
+inline int4 load(const int32_t* p) { return vld1q_s32(p); }
+inline mask4 load(const uint32_t* p) { return vld1q_u32(p); }
+inline u16x8 load(const uint16_t* p) { return vld1q_u16(p); }
+inline void store(float* p, float4 a) { vst1q_f32(p, a); }
+inline void store(int32_t* p, int4 a) { vst1q_s32(p, a); }
+inline void store(uint16_t* p, u16x8 a) { vst1q_u16(p, a); }
+inline float4 splat(float a) { return vdupq_n_f32(a); }
+inline int4 splatInt(int32_t a) { return vdupq_n_s32(a); }
+inline u16x8 splatU16(uint16_t a) { return vdupq_n_u16(a); }
+
+inline float4 add(float4 a, float4 b) { return vaddq_f32(a, b); }
+inline float4 sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+inline float4 mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+inline float4 madd(float4 a, float4 b, float4 c) { return vmlaq_f32(a, b, c); } // a + b * c
+inline float4 msub(float4 a, float4 b, float4 c) { return vmlsq_f32(a, b, c); } // a - b * c
+inline float4 neg(float4 a) { return vnegq_f32(a); }
+inline float4 abs(float4 a) { return vabsq_f32(a); }
+inline float4 min(float4 a, float4 b) { return vminq_f32(a, b); }
+inline float4 max(float4 a, float4 b) { return vmaxq_f32(a, b); }
+
+inline mask4 cmpgt(float4 a, float4 b) { return vcgtq_f32(a, b); }
+inline mask4 cmplt(float4 a, float4 b) { return vcltq_f32(a, b); }
+inline mask4 cmpge(float4 a, float4 b) { return vcgeq_f32(a, b); }
+inline mask4 cmple(float4 a, float4 b) { return vcleq_f32(a, b); }
+inline mask4 maskAnd(mask4 a, mask4 b) { return vandq_u32(a, b); }
+inline bool anyLane(mask4 m) {
+    return (vgetq_lane_u32(m, 0) | vgetq_lane_u32(m, 1) | vgetq_lane_u32(m, 2) | vgetq_lane_u32(m, 3)) != 0;
+}
+inline float4 select(mask4 m, float4 a, float4 b) { return vbslq_f32(m, a, b); } // m ? a : b
+
+// Estimate + Newton step pairs: x = x * recipStep(d, x) refines 1/d,
+// x = x * rsqrtStep(d * x, x) refines 1/sqrt(d)
+inline float4 recipEstimate(float4 a) { return vrecpeq_f32(a); }
+inline float4 recipStep(float4 a, float4 b) { return vrecpsq_f32(a, b); } // 2 - a * b
+inline float4 rsqrtEstimate(float4 a) { return vrsqrteq_f32(a); }
+inline float4 rsqrtStep(float4 a, float4 b) { return vrsqrtsq_f32(a, b); } // (3 - a * b) / 2
+
+// (a0 + a2) + (a1 + a3)
+inline float hadd(float4 a) {
+    const float32x2_t sum = vadd_f32(vget_low_f32(a), vget_high_f32(a));
+    return vget_lane_f32(vpadd_f32(sum, sum), 0);
+}
+inline float hmax(float4 a) {
+    return fmaxf(fmaxf(vgetq_lane_f32(a, 0), vgetq_lane_f32(a, 1)), fmaxf(vgetq_lane_f32(a, 2), vgetq_lane_f32(a, 3)));
+}
+
+inline int4 add(int4 a, int4 b) { return vaddq_s32(a, b); }
+inline int4 madd(int4 a, int4 b, int4 c) { return vmlaq_s32(a, b, c); }
+inline int4 min(int4 a, int4 b) { return vminq_s32(a, b); }
+inline int4 toInt(float4 a) { return vcvtq_s32_f32(a); } // Truncates toward zero
+inline float4 toFloat(int4 a) { return vcvtq_f32_s32(a); }
+
+inline u16x8 subSaturate(u16x8 a, u16x8 b) { return vqsubq_u16(a, b); }
+
+// base[idx[0..3]] (NEON has no gather)
+inline float4 gather(const float* base, const int32_t* idx) {
+    float4 r = vdupq_n_f32(0.0f);
+    r = vld1q_lane_f32(base + idx[0], r, 0);
+    r = vld1q_lane_f32(base + idx[1], r, 1);
+    r = vld1q_lane_f32(base + idx[2], r, 2);
+    r = vld1q_lane_f32(base + idx[3], r, 3);
+    return r;
+}
+// p[0..7] = x0 y0 x1 y1 ... <-> x, y
+inline void loadInterleaved(const float* p, float4& x, float4& y) {
+    const float32x4x2_t r = vld2q_f32(p);
+    x = r.val[0];
+    y = r.val[1];
+}
+inline void storeInterleaved(float* p, float4 x, float4 y) {
+    float32x4x2_t r;
+    r.val[0] = x;
+    r.val[1] = y;
+    vst2q_f32(p, r);
+}
+
+#elif defined(SIM_SIMD_SSE)
+
+using float4 = __m128;
+using int4 = __m128i;
+// Masks and u16 lanes share a register type with float4 / int4 here, but not on
+// NEON: wrapping them keeps code that builds on x86 building for Android.
+struct mask4 { __m128 v; }; // All-ones / all-zeros lanes
+struct u16x8 { __m128i v; };
+
+inline float4 load(const float* p) { return _mm_loadu_ps(p); }
+inline int4 load(const int32_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline mask4 load(const uint32_t* p) { return { _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) }; }
+inline u16x8 load(const uint16_t* p) { return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)) }; }
+inline void store(float* p, float4 a) { _mm_storeu_ps(p, a); }
+inline void store(int32_t* p, int4 a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a); }
+inline void store(uint16_t* p, u16x8 a) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), a.v); }
+inline float4 splat(float a) { return _mm_set1_ps(a); }
+inline int4 splatInt(int32_t a) { return _mm_set1_epi32(a); }
+inline u16x8 splatU16(uint16_t a) { return { _mm_set1_epi16(static_cast<short>(a)) }; }
+
+inline float4 add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+inline float4 sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+inline float4 mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+inline float4 madd(float4 a, float4 b, float4 c) { return _mm_add_ps(a, _mm_mul_ps(b, c)); }
+inline float4 msub(float4 a, float4 b, float4 c) { return _mm_sub_ps(a, _mm_mul_ps(b, c)); }
+inline float4 neg(float4 a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+inline float4 abs(float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+inline float4 min(float4 a, float4 b) { return _mm_min_ps(a, b); }
+inline float4 max(float4 a, float4 b) { return _mm_max_ps(a, b); }
+
+inline mask4 cmpgt(float4 a, float4 b) { return { _mm_cmpgt_ps(a, b) }; }
+inline mask4 cmplt(float4 a, float4 b) { return { _mm_cmplt_ps(a, b) }; }
+inline mask4 cmpge(float4 a, float4 b) { return { _mm_cmpge_ps(a, b) }; }
+inline mask4 cmple(float4 a, float4 b) { return { _mm_cmple_ps(a, b) }; }
+inline mask4 maskAnd(mask4 a, mask4 b) { return { _mm_and_ps(a.v, b.v) }; }
+inline bool anyLane(mask4 m) { return _mm_movemask_ps(m.v) != 0; }
+// Bitwise like vbsl (blendv would only look at the sign bits)
+inline float4 select(mask4 m, float4 a, float4 b) { return _mm_or_ps(_mm_and_ps(m.v, a), _mm_andnot_ps(m.v, b)); }
+
+inline float4 recipEstimate(float4 a) { return _mm_rcp_ps(a); }
+inline float4 recipStep(float4 a, float4 b) { return _mm_sub_ps(_mm_set1_ps(2.0f), _mm_mul_ps(a, b)); }
+inline float4 rsqrtEstimate(float4 a) { return _mm_rsqrt_ps(a); }
+inline float4 rsqrtStep(float4 a, float4 b) {
+    return _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(3.0f), _mm_mul_ps(a, b)), _mm_set1_ps(0.5f));
+}
+
+inline float hadd(float4 a) {
+    const __m128 sum = _mm_add_ps(a, _mm_movehl_ps(a, a)); // a0 + a2, a1 + a3
+    return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+inline float hmax(float4 a) {
+    const __m128 m = _mm_max_ps(a, _mm_movehl_ps(a, a));
+    return _mm_cvtss_f32(_mm_max_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+
+inline int4 add(int4 a, int4 b) { return _mm_add_epi32(a, b); }
+inline int4 madd(int4 a, int4 b, int4 c) {
+#if defined(__SSE4_1__)
+    return _mm_add_epi32(a, _mm_mullo_epi32(b, c));
+#else
+    const __m128i even = _mm_mul_epu32(b, c);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(b, 32), _mm_srli_epi64(c, 32));
+    const __m128i prod = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    return _mm_add_epi32(a, prod);
+#endif
+}
+inline int4 min(int4 a, int4 b) {
+#if defined(__SSE4_1__)
+    return _mm_min_epi32(a, b);
+#else
+    const __m128i lt = _mm_cmplt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(lt, a), _mm_andnot_si128(lt, b));
+#endif
+}
+inline int4 toInt(float4 a) { return _mm_cvttps_epi32(a); }
+inline float4 toFloat(int4 a) { return _mm_cvtepi32_ps(a); }
+
+inline u16x8 subSaturate(u16x8 a, u16x8 b) { return { _mm_subs_epu16(a.v, b.v) }; }
+
+inline float4 gather(const float* base, const int32_t* idx) {
+#if defined(__AVX2__)
+    return _mm_i32gather_ps(base, load(idx), 4);
+#else
+    return _mm_setr_ps(base[idx[0]], base[idx[1]], base[idx[2]], base[idx[3]]);
+#endif
+}
+inline void loadInterleaved(const float* p, float4& x, float4& y) {
+    const __m128 a = _mm_loadu_ps(p);
+    const __m128 b = _mm_loadu_ps(p + 4);
+    x = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    y = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+inline void storeInterleaved(float* p, float4 x, float4 y) {
+    _mm_storeu_ps(p, _mm_unpacklo_ps(x, y));
+    _mm_storeu_ps(p + 4, _mm_unpackhi_ps(x, y));
+}
+
+#else // Scalar backend
+
+struct float4 { float v[4]; };
+struct int4 { int32_t v[4]; };
+struct mask4 { uint32_t v[4]; };
+struct u16x8 { uint16_t v[8]; };
+
+inline float4 load(const float* p) { float4 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+inline int4 load(const int32_t* p) { int4 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+inline mask4 load(const uint32_t* p) { mask4 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+inline u16x8 load(const uint16_t* p) { u16x8 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+inline void store(float* p, float4 a) { std::memcpy(p, a.v, sizeof(a.v)); }
+inline void store(int32_t* p, int4 a) { std::memcpy(p, a.v, sizeof(a.v)); }
+inline void store(uint16_t* p, u16x8 a) { std::memcpy(p, a.v, sizeof(a.v)); }
+inline float4 splat(float a) { return {{ a, a, a, a }}; }
+inline int4 splatInt(int32_t a) { return {{ a, a, a, a }}; }
+inline u16x8 splatU16(uint16_t a) { return {{ a, a, a, a, a, a, a, a }}; }
+
+// Lane-wise helpers for the scalar backend only
+template <typename R, typename A, typename F>
+inline R lanewise(const A& a, F f) { R r; for (int k = 0; k < 4; ++k) r.v[k] = f(a.v[k]); return r; }
+template <typename R, typename A, typename B, typename F>
+inline R lanewise(const A& a, const B& b, F f) { R r; for (int k = 0; k < 4; ++k) r.v[k] = f(a.v[k], b.v[k]); return r; }
+inline uint32_t laneMask(bool b) { return b ? 0xFFFFFFFFu : 0u; }
+
+inline float4 add(float4 a, float4 b) { return lanewise<float4>(a, b, [](float x, float y) { return x + y; }); }
+inline float4 sub(float4 a, float4 b) { return lanewise<float4>(a, b, [](float x, float y) { return x - y; }); }
+inline float4 mul(float4 a, float4 b) { return lanewise<float4>(a, b, [](float x, float y) { return x * y; }); }
+inline float4 madd(float4 a, float4 b, float4 c) { return add(a, mul(b, c)); }
+inline float4 msub(float4 a, float4 b, float4 c) { return sub(a, mul(b, c)); }
+inline float4 neg(float4 a) { return lanewise<float4>(a, [](float x) { return -x; }); }
+inline float4 abs(float4 a) { return lanewise<float4>(a, [](float x) { return fabsf(x); }); }
+inline float4 min(float4 a, float4 b) { return lanewise<float4>(a, b, [](float x, float y) { return x < y ? x : y; }); }
+inline float4 max(float4 a, float4 b) { return lanewise<float4>(a, b, [](float x, float y) { return x > y ? x : y; }); }
+
+inline mask4 cmpgt(float4 a, float4 b) { return lanewise<mask4>(a, b, [](float x, float y) { return laneMask(x > y); }); }
+inline mask4 cmplt(float4 a, float4 b) { return lanewise<mask4>(a, b, [](float x, float y) { return laneMask(x < y); }); }
+inline mask4 cmpge(float4 a, float4 b) { return lanewise<mask4>(a, b, [](float x, float y) { return laneMask(x >= y); }); }
+inline mask4 cmple(float4 a, float4 b) { return lanewise<mask4>(a, b, [](float x, float y) { return laneMask(x <= y); }); }
+inline mask4 maskAnd(mask4 a, mask4 b) { return lanewise<mask4>(a, b, [](uint32_t x, uint32_t y) { return x & y; }); }
+inline bool anyLane(mask4 m) { return (m.v[0] | m.v[1] | m.v[2] | m.v[3]) != 0; }
+inline float4 select(mask4 m, float4 a, float4 b) {
+    float4 r;
+    for (int k = 0; k < 4; ++k) r.v[k] = m.v[k] ? a.v[k] : b.v[k];
+    return r;
+}
+
+// Exact "estimates": the Newton steps then leave them (nearly) unchanged
+inline float4 recipEstimate(float4 a) { return lanewise<float4>(a, [](float x) { return 1.0f / x; }); }
+inline float4 recipStep(float4 a, float4 b) { return lanewise<float4>(a, b, [](float x, float y) { return 2.0f - x * y; }); }
+inline float4 rsqrtEstimate(float4 a) { return lanewise<float4>(a, [](float x) { return 1.0f / sqrtf(x); }); }
+inline float4 rsqrtStep(float4 a, float4 b) { return lanewise<float4>(a, b, [](float x, float y) { return (3.0f - x * y) * 0.5f; }); }
+
+inline float hadd(float4 a) { return (a.v[0] + a.v[2]) + (a.v[1] + a.v[3]); }
+inline float hmax(float4 a) { return fmaxf(fmaxf(a.v[0], a.v[1]), fmaxf(a.v[2], a.v[3])); }
+
+inline int4 add(int4 a, int4 b) { return lanewise<int4>(a, b, [](int32_t x, int32_t y) { return x + y; }); }
+inline int4 madd(int4 a, int4 b, int4 c) {
+    int4 r;
+    for (int k = 0; k < 4; ++k) r.v[k] = a.v[k] + b.v[k] * c.v[k];
+    return r;
+}
+inline int4 min(int4 a, int4 b) { return lanewise<int4>(a, b, [](int32_t x, int32_t y) { return x < y ? x : y; }); }
+inline int4 toInt(float4 a) { return lanewise<int4>(a, [](float x) { return static_cast<int32_t>(x); }); }
+inline float4 toFloat(int4 a) { return lanewise<float4>(a, [](int32_t x) { return static_cast<float>(x); }); }
+
+inline u16x8 subSaturate(u16x8 a, u16x8 b) {
+    u16x8 r;
+    for (int k = 0; k < 8; ++k) r.v[k] = a.v[k] > b.v[k] ? static_cast<uint16_t>(a.v[k] - b.v[k]) : 0;
+    return r;
+}
+
+inline float4 gather(const float* base, const int32_t* idx) {
+    return {{ base[idx[0]], base[idx[1]], base[idx[2]], base[idx[3]] }};
+}
+inline void loadInterleaved(const float* p, float4& x, float4& y) {
+    for (int k = 0; k < 4; ++k) { x.v[k] = p[2 * k]; y.v[k] = p[2 * k + 1]; }
+}
+inline void storeInterleaved(float* p, float4 x, float4 y) {
+    for (int k = 0; k < 4; ++k) { p[2 * k] = x.v[k]; p[2 * k + 1] = y.v[k]; }
+}
+
+#endif
+
+// float8: one AVX register, or a pair of float4 elsewhere. Only the streaming
+// ops used over padded arena fields are provided.
+#if defined(SIM_SIMD_AVX)
+
+using float8 = __m256;
+
+inline float8 load8(const float* p) { return _mm256_loadu_ps(p); }
+inline void store(float* p, float8 a) { _mm256_storeu_ps(p, a); }
+inline float8 splat8(float a) { return _mm256_set1_ps(a); }
+inline float8 abs(float8 a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+inline float8 max(float8 a, float8 b) { return _mm256_max_ps(a, b); }
+inline float hmax(float8 a) { return hmax(_mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1))); }
+
+#else
+
+struct float8 { float4 lo, hi; };
+
+inline float8 load8(const float* p) { return { load(p), load(p + 4) }; }
+inline void store(float* p, float8 a) { store(p, a.lo); store(p + 4, a.hi); }
+inline float8 splat8(float a) { return { splat(a), splat(a) }; }
+inline float8 abs(float8 a) { return { abs(a.lo), abs(a.hi) }; }
+inline float8 max(float8 a, float8 b) { return { max(a.lo, b.lo), max(a.hi, b.hi) }; }
+inline float hmax(float8 a) { return hmax(max(a.lo, a.hi)); }
+
+#endif
+
+} // namespace simd
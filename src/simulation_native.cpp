@@ -2,14 +2,78 @@
 #include <cstdint>    // For int32_t
 #include <algorithm>  // For std::max, std::min
 #include <vector>     // Required for pushParticlesApart temporary data if needed
+#include <cstdlib>    // For posix_memalign / free
+#include <new>        // For std::bad_alloc
+#include <cstring>    // For memset
+#include <type_traits> // For std::remove_reference_t
+#include <atomic>     // Snapshot triple buffer / thread flag
+#include <chrono>     // Simulation thread pacing
+#include <mutex>
+#include <thread>
+#include <cstdio>     // Reading cpufreq limits for thread affinity
+#ifdef __linux__
+#include <sched.h>    // sched_setaffinity (Linux / Android)
+#include <unistd.h>   // sysconf
+#endif
 
-#include <arm_neon.h> // Include NEON intrinsics header
 #include <omp.h>      // Include OpenMP header
 
-// Define constants matching Dart code for clarity (optional but good practice)
-const int FLUID_CELL_CPP = 0; // Renamed to avoid conflict if FLUID_CELL is a macro
-const int AIR_CELL_CPP = 1;
-const int SOLID_CELL_CPP = 2;
+#include "simd_vec.h" // NEON / SSE / scalar float4 layer
+#include "simulation_native.h" // sim_* API, buffer ids and modes
+
+const int DEFAULT_THREAD_BUDGET = 2;  // Thermal default for phones / watches
+
+// Every simulation field lives in one SimArena block: each starts on a 64-byte
+// (cache line) boundary and is padded to whole lines, so SIMD loops over a whole
+// field need no scalar remainder.
+const size_t SIMD_ALIGNMENT = 64;
+const size_t SIMD_PAD_FLOATS = SIMD_ALIGNMENT / sizeof(float);
+
+// Rounds an element count up to whole cache lines of floats
+static inline size_t paddedFieldCount(size_t count) {
+    return (count + SIMD_PAD_FLOATS - 1) / SIMD_PAD_FLOATS * SIMD_PAD_FLOATS;
+}
+
+// View of one field inside the arena. Grid fields also own `ghost` elements on
+// both sides (at least one column), so stencils may read one column or row past
+// the grid without bounds checks: floats read 0 there, cellType reads AIR.
+template <typename T>
+struct ArenaField {
+    T* ptr = nullptr;
+    size_t count = 0;  // Logical elements
+    size_t padded = 0; // count rounded up to whole lines; [count, padded) is scratch
+    size_t ghost = 0;  // Elements reserved before ptr and after ptr + padded
+
+    T* data() { return ptr; }
+    const T* data() const { return ptr; }
+    T* begin() { return ptr; }
+    T* end() { return ptr + count; }
+    size_t size() const { return count; }
+    T& operator[](size_t i) { return ptr[i]; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+};
+
+// Owns the single aligned block behind every ArenaField of a SimContext
+struct SimArena {
+    void* block = nullptr;
+    size_t bytes = 0;
+
+    SimArena() = default;
+    SimArena(const SimArena&) = delete;
+    SimArena& operator=(const SimArena&) = delete;
+    ~SimArena() { free(block); }
+};
+
+// Particle color is a single unorm16 "grade" (0 = deep, 65535 = surface highlight).
+// The old RGBA quad only ever carried R (G == R, B and A pinned at 1), and 16 bits
+// keep the 0.001 diffusion step representable where 8 bits would round it away.
+const float GRADE_SCALE = 65535.0f;
+const uint16_t GRADE_FADE = 655;         // 0.01 per step
+const uint16_t GRADE_HIGHLIGHT = 52428;  // 0.8, low-density highlight
+
+// Absolute max-norm divergence at which the PCG solvers stop early when no
+// tolerance is configured (sweep solvers run all iterations in that case)
+const float DEFAULT_PCG_TOLERANCE = 1e-5f;
 
 // Helper function to check if a cell is part of the static circular wall (Unchanged)
 bool isCellStaticWall_native(int ix, int iy, int fNumX_cells, int fNumY_cells, float h_grid,
@@ -40,12 +104,878 @@ bool isCellDraggable_native(int ix, int iy, int fNumX_cells, int fNumY_cells, fl
     return (dx * dx + dy * dy) < (obsRadius * obsRadius);
 }
 
+// Governor tuning. A change needs the smoothed cost over budget for
+// GOVERNOR_DOWNGRADE_FRAMES frames (or under GOVERNOR_UPGRADE_HEADROOM * budget
+// for GOVERNOR_UPGRADE_FRAMES), and is followed by GOVERNOR_COOLDOWN_FRAMES
+// without changes, so settings do not oscillate around the target.
+const float GOVERNOR_SMOOTHING = 0.1f;           // EMA weight of the newest frame
+const int GOVERNOR_DOWNGRADE_FRAMES = 10;
+const int GOVERNOR_UPGRADE_FRAMES = 60;
+const float GOVERNOR_UPGRADE_HEADROOM = 0.7f;
+const int GOVERNOR_COOLDOWN_FRAMES = 30;
+const float GOVERNOR_THERMAL_SLOPE = 0.05f;      // Budget shrinks 5% per degree above the throttle temperature
+const float GOVERNOR_MIN_THERMAL_SCALE = 0.5f;
+const float GOVERNOR_NO_TEMPERATURE = -1000.0f;  // Readings below -900 mean "unknown"
+
+// One level of the multigrid hierarchy (column-major, idx = i * ny + j).
+// Level 0 is the fine pressure grid; each coarser level aggregates 2x2 cells and
+// carries the Galerkin operator for piecewise-constant prolongation, so the circular
+// s mask and the air (Dirichlet) boundary are inherited without rediscretisation.
+// A cell is active iff Adiag > 0; Ax/Ay couple to (i+1, j) / (i, j+1).
+struct MultigridLevel {
+    int nx = 0, ny = 0;
+    std::vector<float> Adiag, Ax, Ay;
+    std::vector<float> x, b, r;
+};
+
+// Fluid cells of the current frame, grouped per column into runs of consecutive
+// rows so grid kernels can skip air/solid cells and still vectorize along j.
+// Built by the P->G transfer; the row spans additionally cover every face a
+// particle can splat to or sample from (particle rows of columns i-1..i+1, grown by one).
+struct FluidCellRuns {
+    int fNumX = 0, fNumY = 0;
+    int numFluidCells = 0;
+    std::vector<int32_t> columnRunStart;  // fNumX + 1 offsets; column i owns runs [columnRunStart[i], columnRunStart[i + 1])
+    std::vector<int32_t> runBegin, runEnd; // Rows [begin, end) of each run
+    std::vector<int32_t> spanLo, spanHi;   // Per column: active rows [lo, hi), empty when lo >= hi
+    std::vector<int32_t> occupiedLo, occupiedHi; // Per column: lowest / highest row holding a particle (lo > hi when empty)
+};
+
+// Faces of the static container (an adjacent cell lies outside the domain or the
+// circle), stored as all-ones / all-zeros lanes so enforcement is a plain select.
+// The container never moves, so these are built once in sim_create.
+struct StaticBoundaryMasks {
+    std::vector<uint32_t> u, v;
+};
+
+// Cell-sorted SoA positions and displacements for the Jacobi separation kernel.
+struct SeparationScratch {
+    std::vector<float> x, y, dx, dy;
+    std::vector<float> g, dg; // Grade and its summed neighbour difference per slot (fused color pass)
+};
+
+// Scratch for transferVelocities_native.
+// P->G: per-thread private accumulation grids. Thread t owns [t * fNumCells, (t + 1) * fNumCells)
+// of each weighted-sum array and [t * fNumX, (t + 1) * fNumX) of the occupancy bounds.
+// The weighted sums are cleared again by the reduction, so they stay zero between frames.
+// G->P: per-face sample validity (1 if either adjacent cell is not AIR, else 0).
+struct TransferScratch {
+    int numThreads = 0, fNumCells = 0, fNumX = 0;
+    std::vector<float> u, v, du, dv;
+    std::vector<int32_t> occupiedLo, occupiedHi;
+    std::vector<float> validU, validV;
+};
+
+// Scratch memory for the pressure solvers. Owned by SimContext so it persists
+// across frames; solveIncompressibility_native falls back to a local one if none is given.
+struct PressureWorkspace {
+    // Red-black SOR
+    std::vector<float> rbCoef[2];  // Per-color omega / sumS for fluid cells, 0 elsewhere
+    std::vector<float> rbDivBias;  // Drift-compensation term subtracted from the divergence
+    std::vector<float> rbPressureUpdate;
+
+    // PCG (full-grid arrays, zero outside fluid cells)
+    std::vector<int32_t> pcgFluidCells; // Fluid cell indices in i-major order
+    std::vector<float> pcgAdiag, pcgAx, pcgAy, pcgPrecon;
+    std::vector<float> pcgPhi, pcgR, pcgZ, pcgD, pcgQ;
+
+    // Multigrid preconditioner hierarchy (levels[0] mirrors the fine PCG operator)
+    std::vector<MultigridLevel> mgLevels;
+
+    // Stats of the most recent solve (residual < 0 when not measured)
+    int lastIterations = 0;
+    float lastResidual = -1.0f;
+};
+
+// Inputs of one sim_step_frame call. The simulation thread keeps the latest set
+// pushed by sim_set_frame_params and reuses it every frame.
+struct SimFrameParams {
+    int numParticles = 0;
+    float frameDt = 0.0f; // <= 0: no parameters received yet, the thread idles
+    int maxSubsteps = 1;
+    float cflNumber = 1.0f;
+    float gravityX = 0.0f, gravityY = 0.0f, flipRatio = 0.0f;
+    int numPressureIters = 0, numParticleIters = 0;
+    float overRelaxation = 1.0f;
+    bool compensateDrift = false, separateParticles = false;
+    bool isObstacleActive = false;
+    float obstacleX = 0.0f, obstacleY = 0.0f, obstacleRadius = 0.0f;
+    float obstacleVelX = 0.0f, obstacleVelY = 0.0f;
+};
+
+// Grid edit requested through the API (sim_set_obstacle / sim_reset_grid).
+// While the simulation thread runs they are queued and applied before its next frame.
+struct GridEdit {
+    bool resetGrid = false; // Otherwise an obstacle stamp
+    bool isObstacleActive = false;
+    float obstacleX = 0.0f, obstacleY = 0.0f, obstacleRadius = 0.0f;
+    float obstacleVelX = 0.0f, obstacleVelY = 0.0f;
+};
+
+// Frame-budget quality governor (sim_set_governor). Bounds come from the
+// caller: the requested frame params are the maxima, the governor config the minima.
+struct QualityGovernor {
+    bool enabled = false;
+    float targetFrameMs = 8.0f;
+    int minPressureIters = 10, minParticleIters = 1;
+    int minThreads = 1, maxThreads = 2;
+    bool mayDropSeparation = false, mayDropColoring = false;
+    float throttleTemperature = 40.0f;
+    std::atomic<float> temperature{GOVERNOR_NO_TEMPERATURE}; // Degrees C, set without locking
+
+    // Current choice; pressureIters / particleIters < 0 mean "as requested"
+    int pressureIters = -1, particleIters = -1;
+    bool separation = true, coloring = true;
+    int threads = 2;
+
+    float smoothedMs = 0.0f;
+    int overFrames = 0, underFrames = 0, cooldown = 0;
+    float state[GOVERNOR_STATE_COUNT] = {};
+};
+
+// Everything the renderer reads from one completed frame.
+struct SimSnapshot {
+    std::vector<float> particleX, particleY;
+    std::vector<uint16_t> particleGrade;
+    std::vector<int32_t> cellType;
+    std::vector<float> particleDensity;
+    std::vector<float> stageTimings;
+    float info[SNAPSHOT_INFO_COUNT] = {};
+    float governorState[GOVERNOR_STATE_COUNT] = {};
+};
+
+// Lock-free triple buffer between the simulation thread (writer) and the UI
+// (reader). Each side owns one slot; `latest` holds the third, most recently
+// published one. Publishing and acquiring swap a private slot with `latest`,
+// so neither side ever waits and the reader never sees a half-written frame.
+struct SnapshotTripleBuffer {
+    static constexpr uint32_t SLOT_MASK = 0x3;
+    static constexpr uint32_t FRESH = 0x4; // latest was published after the reader's last swap
+    SimSnapshot slots[3];
+    std::atomic<uint32_t> latest{2};
+    int writeSlot = 0; // Simulation thread only
+    int readSlot = 1;  // Reader only
+    bool readValid = false; // Reader only: readSlot holds a published frame
+};
+
+// Persistent simulation state. Owns every grid/particle field plus the particle
+// spatial hash so that a whole frame runs without copying data across FFI.
+// Dart only holds an opaque pointer and zero-copy views obtained via sim_get_buffer.
+struct SimContext {
+    SimArena arena; // Backs every ArenaField below
+
+    // Grid (MAC, column-major: idx = i * fNumY + j)
+    int fNumX = 0, fNumY = 0, fNumCells = 0;
+    float h = 0.0f, invH = 0.0f, density = 0.0f;
+    ArenaField<float> u, v, du, dv, prevU, prevV, p, s, particleDensity;
+    ArenaField<int32_t> cellType;
+    FluidCellRuns fluidRuns; // Rebuilt by every P->G transfer
+    TransferScratch transferScratch;
+    StaticBoundaryMasks boundaryMasks; // Built once from the container circle
+
+    // Particles
+    int maxParticles = 0;
+    int numParticles = 0;
+    float particleRadius = 0.0f;
+    float particleRestDensity = 0.0f;
+    int particleLayout = PARTICLE_LAYOUT_INTERLEAVED;
+    ArenaField<float> particleX, particleY, particleVelX, particleVelY; // Kernel-side store
+    ArenaField<float> particlePos, particleVel; // Interleaved API view (PARTICLE_LAYOUT_INTERLEAVED)
+    ArenaField<uint16_t> particleGrade;
+
+    // Particle spatial hash (used by pushParticlesApart / diffuseParticleColors)
+    int pNumX = 0, pNumY = 0, pNumCells = 0;
+    float pInvSpacing = 0.0f;
+    std::vector<int32_t> numCellParticles, firstCellParticle, cellParticleIds;
+    std::vector<int32_t> particleCell;      // Hash cell of each particle from the last build
+    std::vector<int32_t> threadCellCounts;  // Per-thread histograms / scatter cursors (numThreads * pNumCells)
+
+    // Particle separation
+    int separationMode = SEPARATION_GAUSS_SEIDEL;
+    SeparationScratch separationScratch;
+
+    // Spatial reordering of the particle arrays (0 = off)
+    int reorderInterval = 0;
+    int64_t frameCount = 0;
+    std::vector<int32_t> particlePermutation; // New index -> old index of the last reorder
+    std::vector<float> reorderScratch;
+    std::vector<uint16_t> reorderGradeScratch;
+
+    // Profiling
+    std::vector<float> stageTimings; // ms per SimStage for the last frame, summed over its substeps
+
+    // Water line chosen by the last sim_seed_particles (height above the container bottom)
+    float seedFillHeight = 0.0f;
+
+    // Scene
+    float circleCenterX = 0.0f, circleCenterY = 0.0f, circleRadius = 0.0f;
+    bool enableDynamicColoring = false;
+
+    // Pressure solve
+    int pressureSolver = PRESSURE_SOLVER_GAUSS_SEIDEL;
+    float pressureTolerance = 0.0f; // <= 0: fixed iteration count for the sweep solvers
+    int pressureCheckInterval = 5;
+    bool pressureWarmStart = false; // Keep p between frames as the initial guess
+    PressureWorkspace pressureWs;
+
+    // Background simulation thread (sim_start_thread). stepMutex is held while a
+    // frame runs and by every API call that edits simulation state; frameParams
+    // and queued grid edits have their own lock so the UI never waits for a frame.
+    std::mutex stepMutex;
+    std::mutex paramsMutex;
+    SimFrameParams frameParams;
+    std::vector<GridEdit> pendingGridEdits;
+    std::thread simThread;
+    std::atomic<bool> simThreadRunning{false};
+    SnapshotTripleBuffer snapshots;
+
+    // Worker pool. OpenMP keeps one persistent team per thread that runs frames;
+    // the settings below are (re)applied to that team when threadConfigSerial changes.
+    int threadBudget = DEFAULT_THREAD_BUDGET; // <= 0: one worker per processor
+    int threadAffinity = THREAD_AFFINITY_ANY;
+    int threadSpinMillis = -1;                // Idle spin before workers park; < 0 keeps the runtime default
+    uint64_t threadConfigSerial = 0;          // See bumpThreadConfig_native
+
+    QualityGovernor governor; // Overrides iterations, optional passes and threadBudget when enabled
+};
+
+// Serials come from one process-wide generation, so a context created at a freed
+// context's address can never match a thread's cached serial.
+static std::atomic<uint64_t> threadConfigGeneration{0};
+
+static inline void bumpThreadConfig_native(SimContext* ctx) {
+    ctx->threadConfigSerial = threadConfigGeneration.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
 
 // Use extern "C" to prevent C++ name mangling for FFI compatibility
 extern "C" {
 
+    // Rebuilds the fluid runs from cellType. When hasOccupancy is false the particle
+    // rows are taken from the fluid cells themselves (enough for the pressure passes).
+    static void buildFluidCellRuns_native(
+        const int32_t* cellType, int fNumX, int fNumY, bool hasOccupancy, FluidCellRuns* runs
+    ) {
+        const int n = fNumY;
+        runs->fNumX = fNumX;
+        runs->fNumY = fNumY;
+        runs->columnRunStart.assign(fNumX + 1, 0);
+        runs->spanLo.resize(fNumX);
+        runs->spanHi.resize(fNumX);
+        if (!hasOccupancy) {
+            runs->occupiedLo.assign(fNumX, fNumY);
+            runs->occupiedHi.assign(fNumX, -1);
+        }
+        int32_t* runStart = runs->columnRunStart.data();
+        int32_t* occLo = runs->occupiedLo.data();
+        int32_t* occHi = runs->occupiedHi.data();
+
+        // 1. Count runs per column
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < fNumX; ++i) {
+            const int32_t* col = cellType + i * n;
+            int count = 0;
+            for (int j = 0; j < fNumY; ++j) {
+                if (col[j] == FLUID_CELL_CPP && (j == 0 || col[j - 1] != FLUID_CELL_CPP)) ++count;
+                if (!hasOccupancy && col[j] == FLUID_CELL_CPP) {
+                    occLo[i] = std::min(occLo[i], j);
+                    occHi[i] = j;
+                }
+            }
+            runStart[i + 1] = count;
+        }
+        for (int i = 0; i < fNumX; ++i) runStart[i + 1] += runStart[i];
+        runs->runBegin.resize(runStart[fNumX]);
+        runs->runEnd.resize(runStart[fNumX]);
+        int32_t* runBegin = runs->runBegin.data();
+        int32_t* runEnd = runs->runEnd.data();
+
+        // 2. Fill runs and the dilated per-column spans
+        int numFluidCells = 0;
+        #pragma omp parallel for schedule(static) reduction(+:numFluidCells)
+        for (int i = 0; i < fNumX; ++i) {
+            const int32_t* col = cellType + i * n;
+            int r = runStart[i];
+            for (int j = 0; j < fNumY; ++j) {
+                if (col[j] != FLUID_CELL_CPP) continue;
+                if (j == 0 || col[j - 1] != FLUID_CELL_CPP) runBegin[r] = j;
+                if (j == fNumY - 1 || col[j + 1] != FLUID_CELL_CPP) runEnd[r++] = j + 1;
+                ++numFluidCells;
+            }
+            int lo = fNumY, hi = -1;
+            for (int c = std::max(0, i - 1); c <= std::min(fNumX - 1, i + 1); ++c) {
+                lo = std::min(lo, occLo[c]);
+                hi = std::max(hi, occHi[c]);
+            }
+            runs->spanLo[i] = std::max(0, lo - 1);
+            runs->spanHi[i] = std::min(fNumY, hi + 2);
+        }
+        runs->numFluidCells = numFluidCells;
+    }
+
+    // Applies a per-cell pressure delta (zero outside fluid cells) to column i:
+    // p += cp * pu, and every face adjacent to a non-zero pu gets the GS-style
+    // update (u[left] -= s[left] * pu, u[right] += s[right] * pu, same for v).
+    // Only rows [jBegin, jEnd) are visited; they must cover every non-zero pu of
+    // columns i-1 and i plus one row above (FluidCellRuns spans do).
+    // Columns write disjoint memory, so callers may run this in parallel over i in [1, fNumX).
+    static inline void applyPressureDeltaColumn(
+        int i, float* u, float* v, float* p, const float* s, const float* pu,
+        int fNumX, int fNumY, float cp, int jBegin, int jEnd
+    ) {
+        const int n = fNumY;
+        const simd::float4 cp_vec = simd::splat(cp);
+        const int base = i * n;
+        const bool interiorColumn = i < fNumX - 1;
+        const int jStop = std::min(jEnd, fNumY - 1);
+        int j = std::max(1, jBegin);
+        for (; j <= jStop - 4; j += 4) {
+            const int idx = base + j;
+            const simd::float4 pu_vec = simd::load(&pu[idx]);
+            // u face between (i-1, j) and (i, j)
+            simd::float4 u_vec = simd::load(&u[idx]);
+            u_vec = simd::madd(u_vec, simd::load(&s[idx]), simd::load(&pu[idx - n]));
+            u_vec = simd::msub(u_vec, simd::load(&s[idx - n]), pu_vec);
+            simd::store(&u[idx], u_vec);
+            if (interiorColumn) {
+                // v face between (i, j-1) and (i, j)
+                simd::float4 v_vec = simd::load(&v[idx]);
+                v_vec = simd::madd(v_vec, simd::load(&s[idx]), simd::load(&pu[idx - 1]));
+                v_vec = simd::msub(v_vec, simd::load(&s[idx - 1]), pu_vec);
+                simd::store(&v[idx], v_vec);
+                simd::store(&p[idx], simd::madd(simd::load(&p[idx]), cp_vec, pu_vec));
+            }
+        }
+        for (; j < jStop; ++j) { // Scalar remainder
+            const int idx = base + j;
+            u[idx] += s[idx] * pu[idx - n] - s[idx - n] * pu[idx];
+            if (interiorColumn) {
+                v[idx] += s[idx] * pu[idx - 1] - s[idx - 1] * pu[idx];
+                p[idx] += cp * pu[idx];
+            }
+        }
+        // Top v face of the last interior row
+        if (interiorColumn && j == fNumY - 1) {
+            const int idx = base + fNumY - 1;
+            v[idx] += s[idx] * pu[idx - 1];
+        }
+    }
+
+    // Red-black (checkerboard) SOR. Cells with (i + j) even are red, odd are black.
+    // Same-colored cells never share a face, so each color sweep is split into two
+    // race-free passes over contiguous columns:
+    //   A) pressure update per cell from the current face velocities,
+    //   B) per-face velocity update from the (at most one) non-zero neighbouring update.
+    // Per-cell coefficients are precomputed once per solve so both passes vectorize
+    // without branches on cellType.
+    static void solvePressureRedBlackSOR(
+        float* u, float* v, float* p, const float* s,
+        const float* particleDensity,
+        int fNumX, int fNumY, int numIters,
+        float cp, float overRelaxation,
+        float particleRestDensity, bool compensateDrift,
+        float tolerance, int checkInterval, // tolerance <= 0 disables the residual check
+        const FluidCellRuns* runs, PressureWorkspace* ws
+    ) {
+        const int n = fNumY; // Stride
+        const int fNumCells = fNumX * fNumY;
+        const int32_t* runStart = runs->columnRunStart.data();
+        const int32_t* runBegin = runs->runBegin.data();
+        const int32_t* runEnd = runs->runEnd.data();
+        ws->rbCoef[0].assign(fNumCells, 0.0f);
+        ws->rbCoef[1].assign(fNumCells, 0.0f);
+        ws->rbDivBias.assign(fNumCells, 0.0f);
+        ws->rbPressureUpdate.assign(fNumCells, 0.0f);
+        float* coef[2] = { ws->rbCoef[0].data(), ws->rbCoef[1].data() };
+        float* divBias = ws->rbDivBias.data();
+        float* pu = ws->rbPressureUpdate.data();
+        const bool applyDrift = particleRestDensity > 0.0f && compensateDrift;
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 1; i < fNumX - 1; ++i) {
+            for (int r = runStart[i]; r < runStart[i + 1]; ++r) {
+                for (int j = std::max(1, runBegin[r]); j < std::min(fNumY - 1, runEnd[r]); ++j) {
+                    const int idx = i * n + j;
+                    const float sumS = s[idx - n] + s[idx + n] + s[idx - 1] + s[idx + 1];
+                    if (sumS < 1e-9f) continue;
+                    coef[(i + j) & 1][idx] = overRelaxation / sumS;
+                    if (applyDrift) {
+                        const float comp = particleDensity[idx] - particleRestDensity;
+                        if (comp > 0.0f) divBias[idx] = comp;
+                    }
+                }
+            }
+        }
+
+        const bool checkResidual = tolerance > 0.0f;
+        checkInterval = std::max(1, checkInterval);
+        float sweepResidual = 0.0f; // Max |div - bias| seen by the cells updated in a checked sweep
+
+        #pragma omp parallel
+        {
+            int iter = 0;
+            while (iter < numIters) {
+                const bool checkThisSweep = checkResidual && ((iter + 1) % checkInterval == 0 || iter + 1 == numIters);
+                if (checkThisSweep) {
+                    #pragma omp single
+                    sweepResidual = 0.0f;
+                }
+                for (int color = 0; color < 2; ++color) {
+                    const float* c = coef[color];
+
+                    // Pass A: pu = -(div - bias) * omega / sumS for cells of this color.
+                    // Only fluid runs are visited; pu stays zero everywhere else.
+                    #pragma omp for schedule(static) reduction(max:sweepResidual)
+                    for (int i = 1; i < fNumX - 1; ++i) {
+                        const int base = i * n;
+                        const simd::float4 zero_vec = simd::splat(0.0f);
+                        simd::float4 res_vec = zero_vec;
+                        for (int r = runStart[i]; r < runStart[i + 1]; ++r) {
+                            const int jEnd = std::min(fNumY - 1, runEnd[r]);
+                            int j = std::max(1, runBegin[r]);
+                            for (; j <= jEnd - 4; j += 4) {
+                                const int idx = base + j;
+                                simd::float4 div_vec = simd::sub(simd::load(&u[idx + n]), simd::load(&u[idx]));
+                                div_vec = simd::add(div_vec, simd::sub(simd::load(&v[idx + 1]), simd::load(&v[idx])));
+                                const simd::float4 rhs_vec = simd::sub(simd::load(&divBias[idx]), div_vec);
+                                const simd::float4 c_vec = simd::load(&c[idx]);
+                                simd::store(&pu[idx], simd::mul(rhs_vec, c_vec));
+                                if (checkThisSweep) {
+                                    res_vec = simd::max(res_vec, simd::select(simd::cmpgt(c_vec, zero_vec), simd::abs(rhs_vec), zero_vec));
+                                }
+                            }
+                            for (; j < jEnd; ++j) { // Scalar remainder
+                                const int idx = base + j;
+                                const float div = (u[idx + n] - u[idx]) + (v[idx + 1] - v[idx]);
+                                pu[idx] = (divBias[idx] - div) * c[idx];
+                                if (checkThisSweep && c[idx] > 0.0f) {
+                                    sweepResidual = fmaxf(sweepResidual, fabsf(divBias[idx] - div));
+                                }
+                            }
+                        }
+                        if (checkThisSweep) {
+                            sweepResidual = fmaxf(sweepResidual, simd::hmax(res_vec));
+                        }
+                    }
+
+                    // Pass B: apply pu to p and to the faces it touches
+                    #pragma omp for schedule(static)
+                    for (int i = 1; i < fNumX; ++i) {
+                        applyPressureDeltaColumn(i, u, v, p, s, pu, fNumX, fNumY, cp, runs->spanLo[i], runs->spanHi[i]);
+                    }
+                }
+                ++iter;
+                if (checkThisSweep) {
+                    // Every thread reads the reduced value before anyone can reach the next
+                    // checked sweep's `single` reset (it has no entry barrier), so the whole
+                    // team takes the same branch.
+                    const bool converged = sweepResidual <= tolerance;
+                    #pragma omp barrier
+                    if (converged) break;
+                }
+            }
+            #pragma omp master
+            {
+                ws->lastIterations = iter;
+                ws->lastResidual = checkResidual ? sweepResidual : -1.0f;
+            }
+        }
+    }
+
+    // Max-norm over the fluid cells of a full-grid vector
+    static float fluidMaxAbs_native(const std::vector<int32_t>& cells, const float* x) {
+        const int count = static_cast<int>(cells.size());
+        float m = 0.0f;
+        #pragma omp parallel for schedule(static) reduction(max:m)
+        for (int k = 0; k < count; ++k) {
+            m = fmaxf(m, fabsf(x[cells[k]]));
+        }
+        return m;
+    }
+
+    static double fluidDot_native(const std::vector<int32_t>& cells, const float* a, const float* b) {
+        const int count = static_cast<int>(cells.size());
+        double sum = 0.0;
+        #pragma omp parallel for schedule(static) reduction(+:sum)
+        for (int k = 0; k < count; ++k) {
+            const int idx = cells[k];
+            sum += static_cast<double>(a[idx]) * b[idx];
+        }
+        return sum;
+    }
+
+    // z = M^-1 r with the MIC(0) factor (serial forward/backward substitution)
+    static void applyMICPreconditioner_native(PressureWorkspace* ws, int n) {
+        const std::vector<int32_t>& cells = ws->pcgFluidCells;
+        const float* Ax = ws->pcgAx.data();
+        const float* Ay = ws->pcgAy.data();
+        const float* precon = ws->pcgPrecon.data();
+        const float* r = ws->pcgR.data();
+        float* q = ws->pcgQ.data(); // Intermediate solution of L q = r
+        float* z = ws->pcgZ.data();
+
+        for (size_t k = 0; k < cells.size(); ++k) {
+            const int idx = cells[k];
+            const float t = r[idx]
+                - Ax[idx - n] * precon[idx - n] * q[idx - n]
+                - Ay[idx - 1] * precon[idx - 1] * q[idx - 1];
+            q[idx] = t * precon[idx];
+        }
+        for (size_t k = cells.size(); k-- > 0;) {
+            const int idx = cells[k];
+            const float t = q[idx]
+                - Ax[idx] * precon[idx] * z[idx + n]
+                - Ay[idx] * precon[idx] * z[idx + 1];
+            z[idx] = t * precon[idx];
+        }
+    }
+
+    // --- Multigrid V-cycle preconditioner ---
+    const int MG_SMOOTH_SWEEPS = 2;        // Red-black GS sweeps before and after coarse correction
+    const int MG_COARSEST_SWEEPS = 20;     // Symmetric sweeps on the coarsest level
+    const int MG_MIN_LEVEL_SIZE = 4;       // Stop coarsening once either dimension is this small
+    const int MG_PARALLEL_MIN_CELLS = 4096; // Smaller levels run serially (fork/join not worth it)
+
+    // One red-black Gauss-Seidel half sweep over the given color.
+    static void multigridSmoothColor_native(MultigridLevel& L, int color) {
+        const int nx = L.nx, ny = L.ny;
+        const float* Adiag = L.Adiag.data();
+        const float* Ax = L.Ax.data();
+        const float* Ay = L.Ay.data();
+        const float* b = L.b.data();
+        float* x = L.x.data();
+        #pragma omp parallel for schedule(static) if (nx * ny > MG_PARALLEL_MIN_CELLS)
+        for (int i = 0; i < nx; ++i) {
+            for (int j = ((i + color) & 1); j < ny; j += 2) {
+                const int idx = i * ny + j;
+                if (Adiag[idx] <= 0.0f) continue;
+                float sum = b[idx];
+                if (i + 1 < nx) sum -= Ax[idx] * x[idx + ny];
+                if (i > 0)      sum -= Ax[idx - ny] * x[idx - ny];
+                if (j + 1 < ny) sum -= Ay[idx] * x[idx + 1];
+                if (j > 0)      sum -= Ay[idx - 1] * x[idx - 1];
+                x[idx] = sum / Adiag[idx];
+            }
+        }
+    }
+
+    // Builds levels 1.. from levels[0] (which the caller fills with the fine operator).
+    static void buildMultigridHierarchy_native(PressureWorkspace* ws) {
+        std::vector<MultigridLevel>& levels = ws->mgLevels;
+        size_t numLevels = 1;
+        while (true) {
+            const MultigridLevel& F = levels[numLevels - 1];
+            if (F.nx <= MG_MIN_LEVEL_SIZE || F.ny <= MG_MIN_LEVEL_SIZE) break;
+            if (levels.size() <= numLevels) levels.emplace_back();
+            MultigridLevel& C = levels[numLevels];
+            const MultigridLevel& Fine = levels[numLevels - 1]; // Re-fetch: emplace_back may reallocate
+            C.nx = (Fine.nx + 1) / 2;
+            C.ny = (Fine.ny + 1) / 2;
+            const size_t numCoarse = static_cast<size_t>(C.nx) * C.ny;
+            for (std::vector<float>* field : { &C.Adiag, &C.Ax, &C.Ay, &C.x, &C.b, &C.r }) {
+                field->assign(numCoarse, 0.0f);
+            }
+            // Galerkin P^T A P with P = piecewise-constant injection
+            for (int i = 0; i < Fine.nx; ++i) {
+                for (int j = 0; j < Fine.ny; ++j) {
+                    const int f = i * Fine.ny + j;
+                    if (Fine.Adiag[f] <= 0.0f) continue;
+                    const int ci = i >> 1, cj = j >> 1;
+                    const int c = ci * C.ny + cj;
+                    C.Adiag[c] += Fine.Adiag[f];
+                    if (i + 1 < Fine.nx && Fine.Ax[f] != 0.0f) {
+                        if (((i + 1) >> 1) == ci) C.Adiag[c] += 2.0f * Fine.Ax[f]; // Coupling inside the block
+                        else C.Ax[c] += Fine.Ax[f];
+                    }
+                    if (j + 1 < Fine.ny && Fine.Ay[f] != 0.0f) {
+                        if (((j + 1) >> 1) == cj) C.Adiag[c] += 2.0f * Fine.Ay[f];
+                        else C.Ay[c] += Fine.Ay[f];
+                    }
+                }
+            }
+            // Guard against round-off leaving tiny positive diagonals on blocks
+            // that are fully enclosed by solid (pure Neumann aggregates)
+            for (size_t c = 0; c < numCoarse; ++c) {
+                if (C.Adiag[c] < 1e-6f) C.Adiag[c] = 0.0f;
+            }
+            ++numLevels;
+        }
+        levels.resize(numLevels);
+    }
+
+    static void multigridVCycle_native(PressureWorkspace* ws, size_t level) {
+        MultigridLevel& L = ws->mgLevels[level];
+        std::fill(L.x.begin(), L.x.end(), 0.0f);
+
+        if (level + 1 == ws->mgLevels.size()) {
+            for (int sweep = 0; sweep < MG_COARSEST_SWEEPS; ++sweep) {
+                multigridSmoothColor_native(L, 0);
+                multigridSmoothColor_native(L, 1);
+                multigridSmoothColor_native(L, 1);
+                multigridSmoothColor_native(L, 0);
+            }
+            return;
+        }
+
+        for (int sweep = 0; sweep < MG_SMOOTH_SWEEPS; ++sweep) {
+            multigridSmoothColor_native(L, 0);
+            multigridSmoothColor_native(L, 1);
+        }
+
+        // Residual, restricted by summing the 2x2 children (P^T)
+        MultigridLevel& C = ws->mgLevels[level + 1];
+        const int nx = L.nx, ny = L.ny;
+        std::fill(C.b.begin(), C.b.end(), 0.0f);
+        for (int i = 0; i < nx; ++i) {
+            for (int j = 0; j < ny; ++j) {
+                const int idx = i * ny + j;
+                if (L.Adiag[idx] <= 0.0f) continue;
+                float res = L.b[idx] - L.Adiag[idx] * L.x[idx];
+                if (i + 1 < nx) res -= L.Ax[idx] * L.x[idx + ny];
+                if (i > 0)      res -= L.Ax[idx - ny] * L.x[idx - ny];
+                if (j + 1 < ny) res -= L.Ay[idx] * L.x[idx + 1];
+                if (j > 0)      res -= L.Ay[idx - 1] * L.x[idx - 1];
+                C.b[(i >> 1) * C.ny + (j >> 1)] += res;
+            }
+        }
+
+        multigridVCycle_native(ws, level + 1);
+
+        // Prolongate (piecewise constant) and correct
+        for (int i = 0; i < nx; ++i) {
+            for (int j = 0; j < ny; ++j) {
+                const int idx = i * ny + j;
+                if (L.Adiag[idx] <= 0.0f) continue;
+                L.x[idx] += C.x[(i >> 1) * C.ny + (j >> 1)];
+            }
+        }
+
+        // Post-smoothing in reverse color order keeps the V-cycle symmetric for CG
+        for (int sweep = 0; sweep < MG_SMOOTH_SWEEPS; ++sweep) {
+            multigridSmoothColor_native(L, 1);
+            multigridSmoothColor_native(L, 0);
+        }
+    }
+
+    // z = V-cycle(r)
+    static void applyMultigridPreconditioner_native(PressureWorkspace* ws) {
+        MultigridLevel& fine = ws->mgLevels[0];
+        std::copy(ws->pcgR.begin(), ws->pcgR.end(), fine.b.begin());
+        multigridVCycle_native(ws, 0);
+        std::copy(fine.x.begin(), fine.x.end(), ws->pcgZ.begin());
+    }
+
+    // Conjugate gradient on the fluid-cell Poisson system A phi = b, where
+    //   A = sum over open faces of (phi_c - phi_neighbour), neighbour phi = 0 for air,
+    //   b = driftBias - div.
+    // This is the system the Gauss-Seidel sweep relaxes, so phi plays the role of the
+    // accumulated per-cell pressure_update and is applied with applyPressureDeltaColumn.
+    // The preconditioner is MIC(0), or a multigrid V-cycle when useMultigrid is set.
+    static void solvePressurePCG(
+        float* u, float* v, float* p, const float* s,
+        const float* particleDensity,
+        int fNumX, int fNumY, int maxIters,
+        float cp, float particleRestDensity, bool compensateDrift,
+        bool useMultigrid, float tolerance,
+        const FluidCellRuns* runs, PressureWorkspace* ws
+    ) {
+        const int n = fNumY; // Stride
+        const int fNumCells = fNumX * fNumY;
+        const bool applyDrift = particleRestDensity > 0.0f && compensateDrift;
+
+        for (std::vector<float>* field : { &ws->pcgAdiag, &ws->pcgAx, &ws->pcgAy, &ws->pcgPrecon,
+                                           &ws->pcgPhi, &ws->pcgR, &ws->pcgZ, &ws->pcgD, &ws->pcgQ }) {
+            field->assign(fNumCells, 0.0f);
+        }
+        std::vector<int32_t>& cells = ws->pcgFluidCells;
+        cells.clear();
+
+        float* Adiag = ws->pcgAdiag.data();
+        float* Ax = ws->pcgAx.data();
+        float* Ay = ws->pcgAy.data();
+        float* precon = ws->pcgPrecon.data();
+        float* phi = ws->pcgPhi.data();
+        float* r = ws->pcgR.data();
+        float* z = ws->pcgZ.data();
+        float* d = ws->pcgD.data();
+        float* q = ws->pcgQ.data();
+
+        // --- Assemble A and b ---
+        cells.reserve(runs->numFluidCells);
+        for (int i = 1; i < fNumX - 1; ++i) {
+            for (int k = runs->columnRunStart[i]; k < runs->columnRunStart[i + 1]; ++k) {
+                for (int j = std::max(1, runs->runBegin[k]); j < std::min(fNumY - 1, runs->runEnd[k]); ++j) {
+                    const int idx = i * n + j;
+                    const float sumS = s[idx - n] + s[idx + n] + s[idx - 1] + s[idx + 1];
+                    if (sumS < 1e-9f) continue;
+                    cells.push_back(idx);
+                    Adiag[idx] = sumS;
+                    float div = (u[idx + n] - u[idx]) + (v[idx + 1] - v[idx]);
+                    if (applyDrift) {
+                        const float comp = particleDensity[idx] - particleRestDensity;
+                        if (comp > 0.0f) div -= comp;
+                    }
+                    r[idx] = -div;
+                }
+            }
+        }
+        // Off-diagonals, only between two active cells (Adiag > 0) across an open face
+        for (const int idx : cells) {
+            if (idx + n < fNumCells && Adiag[idx + n] > 0.0f) Ax[idx] = -s[idx + n];
+            if (Adiag[idx + 1] > 0.0f) Ay[idx] = -s[idx + 1];
+        }
+
+        if (useMultigrid) {
+            // --- Multigrid hierarchy (level 0 = this operator) ---
+            if (ws->mgLevels.empty()) ws->mgLevels.emplace_back();
+            MultigridLevel& fine = ws->mgLevels[0];
+            fine.nx = fNumX;
+            fine.ny = fNumY;
+            fine.Adiag = ws->pcgAdiag;
+            fine.Ax = ws->pcgAx;
+            fine.Ay = ws->pcgAy;
+            fine.x.assign(fNumCells, 0.0f);
+            fine.b.assign(fNumCells, 0.0f);
+            fine.r.assign(fNumCells, 0.0f);
+            buildMultigridHierarchy_native(ws);
+        } else {
+            // --- MIC(0) factorization (Bridson, tau = 0.97, sigma = 0.25) ---
+            const float tau = 0.97f;
+            const float sigma = 0.25f;
+            for (const int idx : cells) {
+                const float axl = Ax[idx - n] * precon[idx - n];
+                const float ayb = Ay[idx - 1] * precon[idx - 1];
+                float e = Adiag[idx] - axl * axl - ayb * ayb
+                    - tau * (Ax[idx - n] * Ay[idx - n] * precon[idx - n] * precon[idx - n]
+                           + Ay[idx - 1] * Ax[idx - 1] * precon[idx - 1] * precon[idx - 1]);
+                if (e < sigma * Adiag[idx]) e = Adiag[idx];
+                precon[idx] = 1.0f / sqrtf(e);
+            }
+        }
+        auto applyPreconditioner = [&]() {
+            if (useMultigrid) applyMultigridPreconditioner_native(ws);
+            else applyMICPreconditioner_native(ws, n);
+        };
+
+        // --- PCG iterations ---
+        const int count = static_cast<int>(cells.size());
+        int iter = 0;
+        float residual = fluidMaxAbs_native(cells, r);
+        if (residual > tolerance) {
+            applyPreconditioner();
+            std::copy(ws->pcgZ.begin(), ws->pcgZ.end(), ws->pcgD.begin());
+            double rz = fluidDot_native(cells, z, r);
+
+            while (iter < maxIters) {
+                ++iter;
+                // q = A d
+                #pragma omp parallel for schedule(static)
+                for (int k = 0; k < count; ++k) {
+                    const int idx = cells[k];
+                    q[idx] = Adiag[idx] * d[idx]
+                        + Ax[idx] * d[idx + n] + Ax[idx - n] * d[idx - n]
+                        + Ay[idx] * d[idx + 1] + Ay[idx - 1] * d[idx - 1];
+                }
+                const double dq = fluidDot_native(cells, d, q);
+                if (dq <= 0.0) break;
+                const float alpha = static_cast<float>(rz / dq);
+
+                #pragma omp parallel for schedule(static)
+                for (int k = 0; k < count; ++k) {
+                    const int idx = cells[k];
+                    phi[idx] += alpha * d[idx];
+                    r[idx] -= alpha * q[idx];
+                }
+
+                residual = fluidMaxAbs_native(cells, r);
+                if (residual <= tolerance) break;
+
+                applyPreconditioner();
+                const double rzNew = fluidDot_native(cells, z, r);
+                const float beta = static_cast<float>(rzNew / rz);
+                rz = rzNew;
+
+                #pragma omp parallel for schedule(static)
+                for (int k = 0; k < count; ++k) {
+                    const int idx = cells[k];
+                    d[idx] = z[idx] + beta * d[idx];
+                }
+            }
+        }
+        ws->lastIterations = iter;
+        ws->lastResidual = residual;
+
+        // --- Apply phi to pressure and face velocities ---
+        #pragma omp parallel for schedule(static)
+        for (int i = 1; i < fNumX; ++i) {
+            applyPressureDeltaColumn(i, u, v, p, s, phi, fNumX, fNumY, cp, runs->spanLo[i], runs->spanHi[i]);
+        }
+    }
+
     // Removed __attribute__ for broader compatibility
-    void solveIncompressibility_native(
+    static void buildStaticBoundaryMasks_native(
+        int fNumX, int fNumY, float h,
+        float circleCenterX, float circleCenterY, float circleRadius,
+        StaticBoundaryMasks* masks
+    ) {
+        const int n = fNumY;
+        masks->u.assign(fNumX * fNumY, 0u);
+        masks->v.assign(fNumX * fNumY, 0u);
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < fNumX; ++i) {
+            for (int j = 0; j < fNumY; ++j) {
+                const bool cellStatic = isCellStaticWall_native(i, j, fNumX, fNumY, h, circleCenterX, circleCenterY, circleRadius);
+                const bool leftStatic = isCellStaticWall_native(i - 1, j, fNumX, fNumY, h, circleCenterX, circleCenterY, circleRadius);
+                const bool bottomStatic = isCellStaticWall_native(i, j - 1, fNumX, fNumY, h, circleCenterX, circleCenterY, circleRadius);
+                masks->u[i * n + j] = (cellStatic || leftStatic) ? 0xFFFFFFFFu : 0u;
+                masks->v[i * n + j] = (cellStatic || bottomStatic) ? 0xFFFFFFFFu : 0u;
+            }
+        }
+    }
+
+    // Re-applies the pressure left in p by the previous frame as the initial guess.
+    // In the velocity-update formulation a guess phi = p / cp only counts once its
+    // gradient has been subtracted from the faces, so this zeroes p and pushes phi
+    // through the same face update the solvers use (which also rebuilds p = cp * phi).
+    // Cells that are no longer fluid get phi = 0 (free surface / solid).
+    static void warmStartPressure_native(
+        float* u, float* v, float* p, const float* s,
+        int fNumX, int fNumY, float cp, const FluidCellRuns* runs, PressureWorkspace* ws
+    ) {
+        const int n = fNumY;
+        const int fNumCells = fNumX * fNumY;
+        const float invCp = 1.0f / cp;
+        ws->rbPressureUpdate.assign(fNumCells, 0.0f);
+        float* phi = ws->rbPressureUpdate.data();
+
+        #pragma omp parallel
+        {
+            #pragma omp for schedule(static)
+            for (int i = 1; i < fNumX - 1; ++i) {
+                for (int k = runs->columnRunStart[i]; k < runs->columnRunStart[i + 1]; ++k) {
+                    for (int j = std::max(1, runs->runBegin[k]); j < std::min(fNumY - 1, runs->runEnd[k]); ++j) {
+                        const int idx = i * n + j;
+                        const float sumS = s[idx - n] + s[idx + n] + s[idx - 1] + s[idx + 1];
+                        if (sumS >= 1e-9f) phi[idx] = p[idx] * invCp;
+                    }
+                }
+            }
+            // Implicit barrier: every phi is final before any face reads its neighbours
+            #pragma omp for schedule(static)
+            for (int i = 0; i < fNumX; ++i) {
+                float* col = p + i * n;
+                std::fill(col, col + n, 0.0f);
+            }
+            #pragma omp for schedule(static)
+            for (int i = 1; i < fNumX; ++i) {
+                applyPressureDeltaColumn(i, u, v, p, s, phi, fNumX, fNumY, cp, runs->spanLo[i], runs->spanHi[i]);
+            }
+        }
+    }
+
+    // Internal: takes C++ workspace types and assumes the SimArena field layout;
+    // sim_step / sim_step_frame are the exported way to run it.
+    static void solveIncompressibility_native(
         float* u, float* v, float* p, const float* s, const int32_t* cellType,
         const float* particleDensity,
         int fNumX, int fNumY, int numIters,
@@ -55,224 +985,209 @@ extern "C" {
         float circleCenterX, float circleCenterY, float circleRadius,
         bool isObstacleActive,
         float obstacleX, float obstacleY, float obstacleRadiusCpp,
-        float obstacleVelX, float obstacleVelY
+        float obstacleVelX, float obstacleVelY,
+        // --- Solver selection ---
+        int pressureSolver,
+        float tolerance, int checkInterval, // Early exit once max |div| <= tolerance (checked every checkInterval sweeps); tolerance <= 0 disables
+        bool warmStart, // p holds the previous frame's pressure and is used as the initial guess (otherwise p must be zero)
+        const FluidCellRuns* fluidRuns, // Fluid runs matching cellType (may be nullptr: rebuilt locally)
+        const StaticBoundaryMasks* staticMasks, // Cached container faces (may be nullptr: rebuilt from the circle)
+        PressureWorkspace* ws // Optional persistent scratch (may be nullptr)
     )
     {
-        omp_set_num_threads(2); // Limit threads for thermal management (Phase 4)
         const float cp = density * h / dt;
         const int n = fNumY; // Stride
 
+        PressureWorkspace localWs;
+        if (ws == nullptr) ws = &localWs;
+        FluidCellRuns localRuns;
+        if (fluidRuns == nullptr) {
+            buildFluidCellRuns_native(cellType, fNumX, fNumY, false, &localRuns);
+            fluidRuns = &localRuns;
+        }
+
+        if (warmStart) {
+            warmStartPressure_native(u, v, p, s, fNumX, fNumY, cp, fluidRuns, ws);
+        }
+
+        ws->lastIterations = numIters;
+        ws->lastResidual = -1.0f;
+        if (pressureSolver == PRESSURE_SOLVER_RED_BLACK_SOR) {
+            solvePressureRedBlackSOR(u, v, p, s, particleDensity,
+                                     fNumX, fNumY, numIters, cp, overRelaxation,
+                                     particleRestDensity, compensateDrift,
+                                     tolerance, checkInterval, fluidRuns, ws);
+            numIters = 0; // Skip the serial sweep below
+        } else if (pressureSolver == PRESSURE_SOLVER_PCG || pressureSolver == PRESSURE_SOLVER_MGPCG) {
+            solvePressurePCG(u, v, p, s, particleDensity,
+                             fNumX, fNumY, numIters, cp,
+                             particleRestDensity, compensateDrift,
+                             pressureSolver == PRESSURE_SOLVER_MGPCG,
+                             tolerance > 0.0f ? tolerance : DEFAULT_PCG_TOLERANCE, fluidRuns, ws);
+            numIters = 0;
+        }
+
         // --- Core pressure loop (Keep serial - Gauss-Seidel like structure is sensitive to parallelization) ---
+        const bool checkResidual = tolerance > 0.0f;
+        checkInterval = std::max(1, checkInterval);
+        const int32_t* runStart = fluidRuns->columnRunStart.data();
+        const int32_t* runBegin = fluidRuns->runBegin.data();
+        const int32_t* runEnd = fluidRuns->runEnd.data();
         for (int iter = 0; iter < numIters; ++iter) {
-            for (int i = 1; i < fNumX - 1; ++i) { // Iterate over interior cells
-                for (int j = 1; j < fNumY - 1; ++j) {
-                    const int idx = i * n + j;
-                    if (cellType[idx] != FLUID_CELL_CPP) continue;
-
-                    const int left   = (i - 1) * n + j;
-                    const int right  = (i + 1) * n + j;
-                    const int bottom = i * n + (j - 1);
-                    const int top    = i * n + (j + 1);
-
-                    // Use s values from neighboring cells (as per _vectorized logic)
-                    const float sx0_from_code = s[left];
-                    const float sx1_from_code = s[right];
-                    const float sy0_from_code = s[bottom];
-                    const float sy1_from_code = s[top];
-                    const float sumS = sx0_from_code + sx1_from_code + sy0_from_code + sy1_from_code;
-                    if (sumS < 1e-9f) continue;
-
-                    float div = (u[right] - u[idx]) + (v[top] - v[idx]);
+            const bool checkThisSweep = checkResidual && ((iter + 1) % checkInterval == 0 || iter + 1 == numIters);
+            float sweepResidual = 0.0f;
+            for (int i = 1; i < fNumX - 1; ++i) { // Iterate over interior fluid runs (same order as a full scan)
+                for (int r = runStart[i]; r < runStart[i + 1]; ++r) {
+                    const int jEnd = std::min(fNumY - 1, runEnd[r]);
+                    for (int j = std::max(1, runBegin[r]); j < jEnd; ++j) {
+                        const int idx = i * n + j;
+
+                        const int left   = (i - 1) * n + j;
+                        const int right  = (i + 1) * n + j;
+                        const int bottom = i * n + (j - 1);
+                        const int top    = i * n + (j + 1);
+
+                        // Use s values from neighboring cells (as per _vectorized logic)
+                        const float sx0_from_code = s[left];
+                        const float sx1_from_code = s[right];
+                        const float sy0_from_code = s[bottom];
+                        const float sy1_from_code = s[top];
+                        const float sumS = sx0_from_code + sx1_from_code + sy0_from_code + sy1_from_code;
+                        if (sumS < 1e-9f) continue;
+
+                        float div = (u[right] - u[idx]) + (v[top] - v[idx]);
+
+                        if (particleRestDensity > 0.0f && compensateDrift) {
+                            const float comp = particleDensity[idx] - particleRestDensity;
+                            if (comp > 0.0f) { div -= comp; }
+                        }
 
-                    if (particleRestDensity > 0.0f && compensateDrift) {
-                        const float comp = particleDensity[idx] - particleRestDensity;
-                        if (comp > 0.0f) { div -= comp; }
-                    }
+                        if (checkThisSweep) sweepResidual = fmaxf(sweepResidual, fabsf(div));
 
-                    float pressure_update = -div / sumS * overRelaxation;
-                    p[idx] += cp * pressure_update;
+                        float pressure_update = -div / sumS * overRelaxation;
+                        p[idx] += cp * pressure_update;
 
-                    // Apply velocity updates (matching _vectorized)
-                    u[idx]    -= sx0_from_code * pressure_update;
-                    u[right]  += sx1_from_code * pressure_update;
-                    v[idx]    -= sy0_from_code * pressure_update;
-                    v[top]    += sy1_from_code * pressure_update;
+                        // Apply velocity updates (matching _vectorized)
+                        u[idx]    -= sx0_from_code * pressure_update;
+                        u[right]  += sx1_from_code * pressure_update;
+                        v[idx]    -= sy0_from_code * pressure_update;
+                        v[top]    += sy1_from_code * pressure_update;
+                    }
                 }
             }
+            if (checkThisSweep) {
+                ws->lastIterations = iter + 1;
+                ws->lastResidual = sweepResidual;
+                if (sweepResidual <= tolerance) break;
+            }
         } // --- End core pressure loop ---
 
-        // --- Boundary Condition Enforcement (Vectorized NEON + OpenMP) ---
-        const float circleRadiusSq = circleRadius * circleRadius;
-        const float obstacleRadiusSq = obstacleRadiusCpp * obstacleRadiusCpp;
-        const float32x4_t zero_f32x4 = vdupq_n_f32(0.0f);
-        const int32x4_t fNumX_cells_vec = vdupq_n_s32(fNumX);
-        const int32x4_t fNumY_cells_vec = vdupq_n_s32(fNumY);
-        const float32x4_t h_grid_vec = vdupq_n_f32(h);
-        const float32x4_t half_vec = vdupq_n_f32(0.5f);
-        const int32x4_t const_zero_s32x4 = vdupq_n_s32(0);
-        const int32_t inc4_arr_local[4] = { 0, 1, 2, 3 }; // Local copy for vld1q if needed
-
-        // Enforce U-velocities (Parallelize outer loop)
+        // --- Boundary Condition Enforcement ---
+        // Static container: masked select against the cached face masks (Vectorized SIMD + OpenMP)
+        StaticBoundaryMasks localMasks;
+        if (staticMasks == nullptr) {
+            buildStaticBoundaryMasks_native(fNumX, fNumY, h, circleCenterX, circleCenterY, circleRadius, &localMasks);
+            staticMasks = &localMasks;
+        }
+        const uint32_t* staticU = staticMasks->u.data();
+        const uint32_t* staticV = staticMasks->v.data();
         #pragma omp parallel for schedule(static)
-        for (int i_face = 0; i_face < fNumX; ++i_face) {
-            const float32x4_t obstacleVelX_vec = vdupq_n_f32(obstacleVelX);
-            const int32x4_t j_inc_vec = vld1q_s32(inc4_arr_local); // {0, 1, 2, 3}
-
-            int j_row = 0;
-            // Vectorized part
-            for (; j_row <= fNumY - 4; j_row += 4) {
-                int u_idx_base = i_face * n + j_row;
-                float32x4_t u_val_vec = vld1q_f32(&u[u_idx_base]);
-                float32x4_t final_u_val_vec = u_val_vec;
-
-                int32x4_t j_row_base_vec = vdupq_n_s32(j_row);
-                int32x4_t j_row_vec = vaddq_s32(j_row_base_vec, j_inc_vec); // {j, j+1, j+2, j+3}
-
-                uint32x4_t overall_static_mask = vdupq_n_u32(0);
-                uint32x4_t overall_draggable_mask = vdupq_n_u32(0);
-
-                // Check adjacent cells (left: i_face-1, right: i_face)
-                for (int side = 0; side < 2; ++side) {
-                    int ix = (side == 0) ? (i_face - 1) : i_face;
-                    int32x4_t ix_vec = vdupq_n_s32(ix);
-
-                    // Static check
-                    uint32x4_t static_domain_mask = vorrq_u32(vorrq_u32(vcltq_s32(ix_vec, const_zero_s32x4), vcgeq_s32(ix_vec, fNumX_cells_vec)), vorrq_u32(vcltq_s32(j_row_vec, const_zero_s32x4), vcgeq_s32(j_row_vec, fNumY_cells_vec)));
-                    float32x4_t cell_center_x_vec = vmulq_f32(vaddq_f32(vcvtq_f32_s32(ix_vec), half_vec), h_grid_vec);
-                    float32x4_t cell_center_y_vec = vmulq_f32(vaddq_f32(vcvtq_f32_s32(j_row_vec), half_vec), h_grid_vec);
-                    float32x4_t dx_static_vec = vsubq_f32(cell_center_x_vec, vdupq_n_f32(circleCenterX));
-                    float32x4_t dy_static_vec = vsubq_f32(cell_center_y_vec, vdupq_n_f32(circleCenterY));
-                    float32x4_t dist_sq_static_vec = vmlaq_f32(vmulq_f32(dx_static_vec, dx_static_vec), dy_static_vec, dy_static_vec);
-                    uint32x4_t static_radius_mask = vcgtq_f32(dist_sq_static_vec, vdupq_n_f32(circleRadiusSq));
-                    uint32x4_t cell_is_static = vorrq_u32(static_domain_mask, static_radius_mask);
-                    overall_static_mask = vorrq_u32(overall_static_mask, cell_is_static);
-
-                    // Draggable check
-                    uint32x4_t cell_is_draggable = vdupq_n_u32(0);
-                    if (isObstacleActive) {
-                        uint32x4_t draggable_domain_mask = static_domain_mask; // Reuse domain check
-                        float32x4_t dx_drag_vec = vsubq_f32(cell_center_x_vec, vdupq_n_f32(obstacleX));
-                        float32x4_t dy_drag_vec = vsubq_f32(cell_center_y_vec, vdupq_n_f32(obstacleY));
-                        float32x4_t dist_sq_drag_vec = vmlaq_f32(vmulq_f32(dx_drag_vec, dx_drag_vec), dy_drag_vec, dy_drag_vec);
-                        uint32x4_t draggable_radius_mask = vcltq_f32(dist_sq_drag_vec, vdupq_n_f32(obstacleRadiusSq));
-                        cell_is_draggable = vandq_u32(vmvnq_u32(draggable_domain_mask), draggable_radius_mask); // NOT outside domain AND inside radius
-                        overall_draggable_mask = vorrq_u32(overall_draggable_mask, cell_is_draggable);
-                    }
-                }
-                // Apply conditions
-                uint32x4_t not_static_mask = vmvnq_u32(overall_static_mask);
-                uint32x4_t not_static_and_draggable_mask = vandq_u32(not_static_mask, overall_draggable_mask);
-                final_u_val_vec = vbslq_f32(overall_static_mask, zero_f32x4, final_u_val_vec); // If static, set 0
-                final_u_val_vec = vbslq_f32(not_static_and_draggable_mask, obstacleVelX_vec, final_u_val_vec); // If not static and draggable, set obsVel
-
-                vst1q_f32(&u[u_idx_base], final_u_val_vec);
+        for (int i = 0; i < fNumX; ++i) {
+            const simd::float4 zero_vec = simd::splat(0.0f);
+            const int base = i * n;
+            int j = 0;
+            for (; j <= fNumY - 4; j += 4) {
+                const int idx = base + j;
+                simd::store(&u[idx], simd::select(simd::load(&staticU[idx]), zero_vec, simd::load(&u[idx])));
+                simd::store(&v[idx], simd::select(simd::load(&staticV[idx]), zero_vec, simd::load(&v[idx])));
             }
-            // Scalar remainder loop
-            for (; j_row < fNumY; ++j_row) {
-                int u_idx = i_face * n + j_row;
-                bool adj_left_cell_static  = isCellStaticWall_native(i_face - 1, j_row, fNumX, fNumY, h, circleCenterX, circleCenterY, circleRadius);
-                bool adj_right_cell_static = isCellStaticWall_native(i_face, j_row,     fNumX, fNumY, h, circleCenterX, circleCenterY, circleRadius);
-                bool adj_left_cell_draggable  = isCellDraggable_native(i_face - 1, j_row, fNumX, fNumY, h, isObstacleActive, obstacleX, obstacleY, obstacleRadiusCpp);
-                bool adj_right_cell_draggable = isCellDraggable_native(i_face, j_row,     fNumX, fNumY, h, isObstacleActive, obstacleX, obstacleY, obstacleRadiusCpp);
-
-                if (adj_left_cell_static || adj_right_cell_static) { u[u_idx] = 0.0f; }
-                else if (adj_left_cell_draggable || adj_right_cell_draggable) { u[u_idx] = obstacleVelX; }
+            for (; j < fNumY; ++j) { // Scalar remainder
+                const int idx = base + j;
+                if (staticU[idx]) u[idx] = 0.0f;
+                if (staticV[idx]) v[idx] = 0.0f;
             }
-        } // End parallel U enforcement
+        }
 
-        // Enforce V-velocities (Parallelize outer loop)
-        #pragma omp parallel for schedule(static)
-        for (int i_col = 0; i_col < fNumX; ++i_col) {
-            const float32x4_t obstacleVelY_vec = vdupq_n_f32(obstacleVelY);
-            const int32x4_t const_one_s32x4 = vdupq_n_s32(1);
-            const int32x4_t j_inc_vec = vld1q_s32(inc4_arr_local); // {0, 1, 2, 3}
-
-            int j_face = 0;
-            // Vectorized part
-            for (; j_face <= fNumY - 4; j_face += 4) {
-                int v_idx_base = i_col * n + j_face;
-                float32x4_t v_val_vec = vld1q_f32(&v[v_idx_base]);
-                float32x4_t final_v_val_vec = v_val_vec;
-
-                int32x4_t j_face_base_vec = vdupq_n_s32(j_face);
-                int32x4_t j_face_vec = vaddq_s32(j_face_base_vec, j_inc_vec); // {j, j+1, j+2, j+3}
-
-                uint32x4_t overall_static_mask = vdupq_n_u32(0);
-                uint32x4_t overall_draggable_mask = vdupq_n_u32(0);
-                int32x4_t ix_vec = vdupq_n_s32(i_col);
-
-                // Check adjacent cells (bottom: j_face-1, top: j_face)
-                for (int side = 0; side < 2; ++side) {
-                    int32x4_t iy_vec = (side == 0) ? vsubq_s32(j_face_vec, const_one_s32x4) : j_face_vec;
-
-                    // Static check
-                    uint32x4_t static_domain_mask = vorrq_u32(vorrq_u32(vcltq_s32(ix_vec, const_zero_s32x4), vcgeq_s32(ix_vec, fNumX_cells_vec)), vorrq_u32(vcltq_s32(iy_vec, const_zero_s32x4), vcgeq_s32(iy_vec, fNumY_cells_vec)));
-                    float32x4_t cell_center_x_vec = vmulq_f32(vaddq_f32(vcvtq_f32_s32(ix_vec), half_vec), h_grid_vec);
-                    float32x4_t cell_center_y_vec = vmulq_f32(vaddq_f32(vcvtq_f32_s32(iy_vec), half_vec), h_grid_vec);
-                    float32x4_t dx_static_vec = vsubq_f32(cell_center_x_vec, vdupq_n_f32(circleCenterX));
-                    float32x4_t dy_static_vec = vsubq_f32(cell_center_y_vec, vdupq_n_f32(circleCenterY));
-                    float32x4_t dist_sq_static_vec = vmlaq_f32(vmulq_f32(dx_static_vec, dx_static_vec), dy_static_vec, dy_static_vec);
-                    uint32x4_t static_radius_mask = vcgtq_f32(dist_sq_static_vec, vdupq_n_f32(circleRadiusSq));
-                    uint32x4_t cell_is_static = vorrq_u32(static_domain_mask, static_radius_mask);
-                    overall_static_mask = vorrq_u32(overall_static_mask, cell_is_static);
-
-                    // Draggable check
-                    uint32x4_t cell_is_draggable = vdupq_n_u32(0);
-                    if (isObstacleActive) {
-                        uint32x4_t draggable_domain_mask = static_domain_mask;
-                        float32x4_t dx_drag_vec = vsubq_f32(cell_center_x_vec, vdupq_n_f32(obstacleX));
-                        float32x4_t dy_drag_vec = vsubq_f32(cell_center_y_vec, vdupq_n_f32(obstacleY));
-                        float32x4_t dist_sq_drag_vec = vmlaq_f32(vmulq_f32(dx_drag_vec, dx_drag_vec), dy_drag_vec, dy_drag_vec);
-                        uint32x4_t draggable_radius_mask = vcltq_f32(dist_sq_drag_vec, vdupq_n_f32(obstacleRadiusSq));
-                        cell_is_draggable = vandq_u32(vmvnq_u32(draggable_domain_mask), draggable_radius_mask);
-                        overall_draggable_mask = vorrq_u32(overall_draggable_mask, cell_is_draggable);
+        // Draggable obstacle: rasterised per frame, only inside its bounding box.
+        // Faces already pinned by the container keep zero velocity.
+        if (isObstacleActive) {
+            const float invH = 1.0f / h;
+            // Cells whose centre can lie inside the obstacle
+            const int cellLoX = std::max(0, static_cast<int>(floorf((obstacleX - obstacleRadiusCpp) * invH - 0.5f)));
+            const int cellHiX = std::min(fNumX - 1, static_cast<int>(ceilf((obstacleX + obstacleRadiusCpp) * invH - 0.5f)));
+            const int cellLoY = std::max(0, static_cast<int>(floorf((obstacleY - obstacleRadiusCpp) * invH - 0.5f)));
+            const int cellHiY = std::min(fNumY - 1, static_cast<int>(ceilf((obstacleY + obstacleRadiusCpp) * invH - 0.5f)));
+
+            // u faces between (i-1, j) and (i, j)
+            for (int i = cellLoX; i <= std::min(fNumX - 1, cellHiX + 1); ++i) {
+                for (int j = cellLoY; j <= cellHiY; ++j) {
+                    const int idx = i * n + j;
+                    if (staticU[idx]) continue;
+                    if (isCellDraggable_native(i - 1, j, fNumX, fNumY, h, true, obstacleX, obstacleY, obstacleRadiusCpp) ||
+                        isCellDraggable_native(i, j, fNumX, fNumY, h, true, obstacleX, obstacleY, obstacleRadiusCpp)) {
+                        u[idx] = obstacleVelX;
                     }
                 }
-                // Apply conditions
-                uint32x4_t not_static_mask = vmvnq_u32(overall_static_mask);
-                uint32x4_t not_static_and_draggable_mask = vandq_u32(not_static_mask, overall_draggable_mask);
-                final_v_val_vec = vbslq_f32(overall_static_mask, zero_f32x4, final_v_val_vec);
-                final_v_val_vec = vbslq_f32(not_static_and_draggable_mask, obstacleVelY_vec, final_v_val_vec);
-
-                vst1q_f32(&v[v_idx_base], final_v_val_vec);
             }
-            // Scalar remainder loop
-            for (; j_face < fNumY; ++j_face) {
-                int v_idx = i_col * n + j_face;
-                bool adj_bottom_cell_static = isCellStaticWall_native(i_col, j_face - 1, fNumX, fNumY, h, circleCenterX, circleCenterY, circleRadius);
-                bool adj_top_cell_static    = isCellStaticWall_native(i_col, j_face,     fNumX, fNumY, h, circleCenterX, circleCenterY, circleRadius);
-                bool adj_bottom_cell_draggable = isCellDraggable_native(i_col, j_face - 1, fNumX, fNumY, h, isObstacleActive, obstacleX, obstacleY, obstacleRadiusCpp);
-                bool adj_top_cell_draggable    = isCellDraggable_native(i_col, j_face,     fNumX, fNumY, h, isObstacleActive, obstacleX, obstacleY, obstacleRadiusCpp);
-
-                if (adj_bottom_cell_static || adj_top_cell_static) { v[v_idx] = 0.0f; }
-                else if (adj_bottom_cell_draggable || adj_top_cell_draggable) { v[v_idx] = obstacleVelY; }
+            // v faces between (i, j-1) and (i, j)
+            for (int i = cellLoX; i <= cellHiX; ++i) {
+                for (int j = cellLoY; j <= std::min(fNumY - 1, cellHiY + 1); ++j) {
+                    const int idx = i * n + j;
+                    if (staticV[idx]) continue;
+                    if (isCellDraggable_native(i, j - 1, fNumX, fNumY, h, true, obstacleX, obstacleY, obstacleRadiusCpp) ||
+                        isCellDraggable_native(i, j, fNumX, fNumY, h, true, obstacleX, obstacleY, obstacleRadiusCpp)) {
+                        v[idx] = obstacleVelY;
+                    }
+                }
             }
-        } // End parallel V enforcement
+        }
     } // End solveIncompressibility_native
 
 
+    // Grade after moving `delta` toward neighbours whose summed grade difference is
+    // `diff`, rounded to nearest. A nonzero move that rounds away is taken as one
+    // unit instead, unless that would cross the midpoint (|diff| < 2), so grades
+    // closer than ~0.5 / coeff units still converge.
+    static inline uint16_t diffusedGrade_native(float grade, float delta, float diff) {
+        const uint16_t rounded = static_cast<uint16_t>(fmaxf(0.0f, fminf(grade + delta, GRADE_SCALE)) + 0.5f);
+        if (rounded != static_cast<uint16_t>(grade) || fabsf(diff) < 2.0f) return rounded;
+        return static_cast<uint16_t>(diff > 0.0f ? grade + 1.0f : grade - 1.0f);
+    }
+
+    // Moves an overlapping pair's grades toward their average by colorDiffusionCoeff
+    // (shared by diffuseParticleColors_native and the fused sweeps)
+    static inline void diffusePairGrade_native(uint16_t* particleGrade, int ii, int jj, float colorDiffusionCoeff) {
+        const float pg = particleGrade[ii];
+        const float qg = particleGrade[jj];
+        const float delta = 0.5f * colorDiffusionCoeff * (qg - pg);
+        particleGrade[ii] = diffusedGrade_native(pg, delta, qg - pg);
+        particleGrade[jj] = diffusedGrade_native(qg, -delta, pg - qg);
+    }
+
     // Removed __attribute__ for broader compatibility
+    // particleGrade may be nullptr; otherwise the last iteration also diffuses the
+    // colors of every overlapping pair it visits (fused diffuseParticleColors_native).
     void pushParticlesApart_native(
-        float* particlePos, // Removed particleColor_param
+        float* particleX, float* particleY,
         const int32_t* firstCellParticle, const int32_t* cellParticleIds,
         int numParticles, int pNumX, int pNumY,
         float pInvSpacing, int numIters,
-        float particleRadius, float minDist2 // Removed enableDynamicColoring
+        float particleRadius, float minDist2,
+        uint16_t* particleGrade, float colorDiffusionCoeff
         )
     {
         const float minDist = 2.0f * particleRadius;
         const int pn = pNumY; // Stride for particle grid
-        // const float colorDiffusionCoeff = 0.001f; // Removed
 
         // Keep serial - parallelizing this naively causes race conditions
         for (int iter = 0; iter < numIters; ++iter) {
+            const bool diffuseColors = particleGrade != nullptr && iter == numIters - 1;
             for (int ii = 0; ii < numParticles; ++ii) {
-                const int pIdx = 2 * ii;
                 // const int pColorIdx = 3 * ii; // Removed
                 // Load particle i's position (needed fresh if modified in inner loop)
                 float p_pos_scalar_arr[2];
-                p_pos_scalar_arr[0] = particlePos[pIdx];
-                p_pos_scalar_arr[1] = particlePos[pIdx + 1];
+                p_pos_scalar_arr[0] = particleX[ii];
+                p_pos_scalar_arr[1] = particleY[ii];
                 const float px = p_pos_scalar_arr[0]; // Keep scalar copy for grid calc
                 const float py = p_pos_scalar_arr[1];
                 // float32x2_t p_pos_vec = vld1_f32(p_pos_scalar_arr); // Vector version - kept scalar for now
@@ -306,14 +1221,13 @@ extern "C" {
                             if (jj == ii) continue;
                             if (jj < 0 || jj >= numParticles) continue;
 
-                            const int qIdx = 2 * jj;
                             // const int qColorIdx = 3 * jj; // Removed
 
                             // --- Interaction (Scalar for dist2 and position update) ---
-                            float p_curr_x = particlePos[pIdx + 0];
-                            float p_curr_y = particlePos[pIdx + 1];
-                            float q_curr_x = particlePos[qIdx + 0];
-                            float q_curr_y = particlePos[qIdx + 1];
+                            float p_curr_x = particleX[ii];
+                            float p_curr_y = particleY[ii];
+                            float q_curr_x = particleX[jj];
+                            float q_curr_y = particleY[jj];
 
                             float dx_scalar = q_curr_x - p_curr_x;
                             float dy_scalar = q_curr_y - p_curr_y;
@@ -327,13 +1241,13 @@ extern "C" {
                             float offset_x = dx_scalar * s_factor;
                             float offset_y = dy_scalar * s_factor;
 
-                            particlePos[pIdx + 0] = p_curr_x - offset_x;
-                            particlePos[pIdx + 1] = p_curr_y - offset_y;
-                            particlePos[qIdx + 0] = q_curr_x + offset_x;
-                            particlePos[qIdx + 1] = q_curr_y + offset_y;
+                            particleX[ii] = p_curr_x - offset_x;
+                            particleY[ii] = p_curr_y - offset_y;
+                            particleX[jj] = q_curr_x + offset_x;
+                            particleY[jj] = q_curr_y + offset_y;
 
-                            // --- Color Diffusion (Scalar) ---
-                            // Removed from here
+                            // --- Color Diffusion (final iteration, same pair test) ---
+                            if (diffuseColors) diffusePairGrade_native(particleGrade, ii, jj, colorDiffusionCoeff);
                         }
                     }
                 }
@@ -341,13 +1255,221 @@ extern "C" {
         }
     } // End pushParticlesApart_native
 
+    // Pushes an overlapping pair apart symmetrically (same update as the serial sweep).
+    // Returns whether the pair overlapped.
+    static inline bool separatePair_native(float* particleX, float* particleY, int ii, int jj, float minDist, float minDist2) {
+        const float px = particleX[ii], py = particleY[ii];
+        const float qx = particleX[jj], qy = particleY[jj];
+        const float dx = qx - px;
+        const float dy = qy - py;
+        const float dist2 = dx * dx + dy * dy;
+        if (dist2 > minDist2 || dist2 < 1e-12f) return false;
+        const float d = sqrtf(dist2);
+        const float s_factor = (d > 1e-9f) ? (0.5f * (minDist - d) / d) : 0.0f;
+        const float offset_x = dx * s_factor;
+        const float offset_y = dy * s_factor;
+        particleX[ii] = px - offset_x;
+        particleY[ii] = py - offset_y;
+        particleX[jj] = qx + offset_x;
+        particleY[jj] = qy + offset_y;
+        return true;
+    }
+
+    // Parallel Gauss-Seidel separation over hash cells in 9 colors. A cell only
+    // touches particles of its 3x3 neighbourhood, and cells of one color are 3 apart
+    // in both directions, so their neighbourhoods are disjoint and can run concurrently.
+    // Particles are taken by hash cell (not re-binned from their moving positions),
+    // which keeps every write inside the owning neighbourhood. Color diffusion in
+    // the fused last iteration writes the same pair, so it inherits the coloring.
+    static void pushParticlesApartColored_native(
+        float* particleX, float* particleY,
+        const int32_t* firstCellParticle, const int32_t* cellParticleIds,
+        int pNumX, int pNumY, int numIters,
+        float particleRadius, float minDist2,
+        uint16_t* particleGrade, float colorDiffusionCoeff
+    ) {
+        const float minDist = 2.0f * particleRadius;
+        #pragma omp parallel
+        {
+            for (int iter = 0; iter < numIters; ++iter) {
+                const bool diffuseColors = particleGrade != nullptr && iter == numIters - 1;
+                for (int color = 0; color < 9; ++color) {
+                    const int ox = color / 3;
+                    const int oy = color % 3;
+                    const int numColorX = std::max(0, (pNumX - ox + 2) / 3);
+                    const int numColorY = std::max(0, (pNumY - oy + 2) / 3);
+
+                    #pragma omp for schedule(static)
+                    for (int k = 0; k < numColorX * numColorY; ++k) {
+                        const int cx = ox + 3 * (k / numColorY);
+                        const int cy = oy + 3 * (k % numColorY);
+                        const int cell = cx * pNumY + cy;
+                        const int x0 = std::max(0, cx - 1), x1 = std::min(pNumX - 1, cx + 1);
+                        const int y0 = std::max(0, cy - 1), y1 = std::min(pNumY - 1, cy + 1);
+
+                        for (int a = firstCellParticle[cell]; a < firstCellParticle[cell + 1]; ++a) {
+                            const int ii = cellParticleIds[a];
+                            for (int nx = x0; nx <= x1; ++nx) {
+                                for (int ny = y0; ny <= y1; ++ny) {
+                                    const int nCell = nx * pNumY + ny;
+                                    for (int b = firstCellParticle[nCell]; b < firstCellParticle[nCell + 1]; ++b) {
+                                        const int jj = cellParticleIds[b];
+                                        if (jj == ii) continue;
+                                        if (separatePair_native(particleX, particleY, ii, jj, minDist, minDist2) && diffuseColors) {
+                                            diffusePairGrade_native(particleGrade, ii, jj, colorDiffusionCoeff);
+                                        }
+                                    }
+                                }
+                            }
+                        }
+                    } // Implicit barrier before the next color
+                }
+            }
+        }
+    }
+
+    // Parallel Jacobi separation: every particle sums its half of each overlap
+    // against the positions of the previous iteration, then all displacements are
+    // applied at once. Order independent (and so bit-stable for any thread count),
+    // but converges more slowly than the in-place sweeps.
+    //
+    // Positions are gathered once into a cell-sorted SoA copy, so the three
+    // neighbour cells of a hash column are one contiguous slot range that the SIMD
+    // pair kernel reads 4 candidates at a time; results are scattered back at the end.
+    // With particleGrade set, the grades ride along in the sorted copy and the last
+    // iteration accumulates each particle's diffusion in the same masked lanes.
+    static void pushParticlesApartJacobi_native(
+        float* particleX, float* particleY, SeparationScratch* scratch,
+        const int32_t* firstCellParticle, const int32_t* cellParticleIds,
+        int numParticles, int pNumX, int pNumY, int numIters,
+        float particleRadius, float minDist2,
+        uint16_t* particleGrade, float colorDiffusionCoeff
+    ) {
+        const float minDist = 2.0f * particleRadius;
+        float* sx = scratch->x.data();
+        float* sy = scratch->y.data();
+        float* dispX = scratch->dx.data();
+        float* dispY = scratch->dy.data();
+        float* sg = scratch->g.data();
+        float* dGrade = scratch->dg.data();
+
+        const simd::float4 v_minDist = simd::splat(minDist);
+        const simd::float4 v_minDist2 = simd::splat(minDist2);
+        const simd::float4 v_eps = simd::splat(1e-12f);
+        const simd::float4 v_half = simd::splat(0.5f);
+        const simd::float4 v_one = simd::splat(1.0f);
+        const simd::float4 v_zero = simd::splat(0.0f);
+
+        #pragma omp parallel
+        {
+            #pragma omp for schedule(static)
+            for (int k = 0; k < numParticles; ++k) {
+                const int ii = cellParticleIds[k];
+                sx[k] = particleX[ii];
+                sy[k] = particleY[ii];
+                if (particleGrade != nullptr) sg[k] = particleGrade[ii];
+            }
+
+            for (int iter = 0; iter < numIters; ++iter) {
+                const bool diffuseColors = particleGrade != nullptr && iter == numIters - 1;
+                #pragma omp for schedule(static)
+                for (int cell = 0; cell < pNumX * pNumY; ++cell) {
+                    const int cx = cell / pNumY;
+                    const int cy = cell - cx * pNumY;
+                    const int x0 = std::max(0, cx - 1), x1 = std::min(pNumX - 1, cx + 1);
+                    const int y0 = std::max(0, cy - 1), y1 = std::min(pNumY - 1, cy + 1);
+
+                    for (int k = firstCellParticle[cell]; k < firstCellParticle[cell + 1]; ++k) {
+                        const float px = sx[k];
+                        const float py = sy[k];
+                        const simd::float4 v_px = simd::splat(px);
+                        const simd::float4 v_py = simd::splat(py);
+                        simd::float4 accX = simd::splat(0.0f);
+                        simd::float4 accY = simd::splat(0.0f);
+                        float tailX = 0.0f, tailY = 0.0f;
+                        const float pg = diffuseColors ? sg[k] : 0.0f;
+                        const simd::float4 v_pg = simd::splat(pg);
+                        simd::float4 gradeAcc = simd::splat(0.0f);
+                        float tailGrade = 0.0f;
+
+                        for (int nx = x0; nx <= x1; ++nx) {
+                            // Rows y0..y1 of column nx are adjacent in the sorted order.
+                            // The particle itself is in range but drops out on dist2 < eps.
+                            const int begin = firstCellParticle[nx * pNumY + y0];
+                            const int end = firstCellParticle[nx * pNumY + y1 + 1];
+                            int m = begin;
+                            for (; m + 3 < end; m += 4) {
+                                const simd::float4 dx = simd::sub(simd::load(sx + m), v_px);
+                                const simd::float4 dy = simd::sub(simd::load(sy + m), v_py);
+                                const simd::float4 d2 = simd::madd(simd::mul(dx, dx), dy, dy);
+                                const simd::mask4 hit = simd::maskAnd(simd::cmple(d2, v_minDist2), simd::cmpge(d2, v_eps));
+                                if (!simd::anyLane(hit)) continue;
+
+                                // 1/d from the estimate plus one Newton-Raphson step
+                                const simd::float4 d2Safe = simd::select(hit, d2, v_one);
+                                simd::float4 invD = simd::rsqrtEstimate(d2Safe);
+                                invD = simd::mul(invD, simd::rsqrtStep(simd::mul(d2Safe, invD), invD));
+                                // 0.5 * (minDist - d) / d = 0.5 * (minDist / d - 1)
+                                simd::float4 sFactor = simd::mul(v_half, simd::madd(simd::neg(v_one), v_minDist, invD));
+                                sFactor = simd::select(hit, sFactor, v_zero);
+                                accX = simd::msub(accX, dx, sFactor);
+                                accY = simd::msub(accY, dy, sFactor);
+
+                                if (diffuseColors) {
+                                    const simd::float4 dg = simd::sub(simd::load(sg + m), v_pg);
+                                    gradeAcc = simd::add(gradeAcc, simd::select(hit, dg, v_zero));
+                                }
+                            }
+                            // Scalar remainder
+                            for (; m < end; ++m) {
+                                const float dx = sx[m] - px;
+                                const float dy = sy[m] - py;
+                                const float dist2 = dx * dx + dy * dy;
+                                if (dist2 > minDist2 || dist2 < 1e-12f) continue;
+                                const float d = sqrtf(dist2);
+                                const float s_factor = 0.5f * (minDist - d) / d;
+                                tailX -= dx * s_factor;
+                                tailY -= dy * s_factor;
+                                if (diffuseColors) tailGrade += sg[m] - pg;
+                            }
+                        }
+
+                        dispX[k] = simd::hadd(accX) + tailX;
+                        dispY[k] = simd::hadd(accY) + tailY;
+                        // Summed grade difference to the overlapping neighbours; each overlap
+                        // moves the grade coeff of the way to the pair average
+                        if (diffuseColors) {
+                            dGrade[k] = simd::hadd(gradeAcc) + tailGrade;
+                        }
+                    }
+                }
+
+                #pragma omp for schedule(static)
+                for (int k = 0; k < numParticles; ++k) {
+                    sx[k] += dispX[k];
+                    sy[k] += dispY[k];
+                    if (diffuseColors) {
+                        particleGrade[cellParticleIds[k]] = diffusedGrade_native(sg[k], 0.5f * colorDiffusionCoeff * dGrade[k], dGrade[k]);
+                    }
+                }
+            }
+
+            #pragma omp for schedule(static)
+            for (int k = 0; k < numParticles; ++k) {
+                const int ii = cellParticleIds[k];
+                particleX[ii] = sx[k];
+                particleY[ii] = sy[k];
+            }
+        }
+    }
+
     // Forward declaration for clamp_cpp
     inline float clamp_cpp(float val, float min_val, float max_val);
 
     // __attribute__((visibility("default"))) __attribute__((used)) // Removed for broader compatibility
     void diffuseParticleColors_native(
-        const float* particlePos, // Read-only for this function
-        float* particleColor_param, // Read & Written
+        const float* particleX, const float* particleY, // Read-only for this function
+        uint16_t* particleGrade_param, // Read & Written
         const int32_t* firstCellParticle,
         const int32_t* cellParticleIds,
         int numParticles,
@@ -360,7 +1482,6 @@ extern "C" {
         if (!enableDynamicColoring || numParticles == 0) {
             return;
         }
-        omp_set_num_threads(2); // Consistent with other particle loops
 
         const float minDist = 2.0f * particleRadius;
         const float minDist2 = minDist * minDist;
@@ -370,11 +1491,8 @@ extern "C" {
         // It's kept serial as color diffusion between a pair (i,j) modifies both i's and j's colors,
         // creating potential race conditions if parallelized naively without atomic operations or complex coloring schemes.
         for (int ii = 0; ii < numParticles; ++ii) {
-            const int pIdx = 2 * ii; // Position index
-            const int pColorIdx = 4 * ii; // Color index (RGBA)
-
-            const float px = particlePos[pIdx];
-            const float py = particlePos[pIdx + 1];
+            const float px = particleX[ii];
+            const float py = particleY[ii];
 
             const int pxi = static_cast<int>(fmaxf(0.0f, fminf(static_cast<float>(pNumX - 1), floorf(px * pInvSpacing))));
             const int pyi = static_cast<int>(fmaxf(0.0f, fminf(static_cast<float>(pNumY - 1), floorf(py * pInvSpacing))));
@@ -398,13 +1516,10 @@ extern "C" {
                         if (jj == ii) continue;
                         if (jj < 0 || jj >= numParticles) continue;
 
-                        const int qIdx = 2 * jj; // Position index for neighbor
-                        const int qColorIdx = 4 * jj; // Color index for neighbor (RGBA)
-
-                        float p_curr_x = particlePos[pIdx + 0];
-                        float p_curr_y = particlePos[pIdx + 1];
-                        float q_curr_x = particlePos[qIdx + 0];
-                        float q_curr_y = particlePos[qIdx + 1];
+                        float p_curr_x = particleX[ii];
+                        float p_curr_y = particleY[ii];
+                        float q_curr_x = particleX[jj];
+                        float q_curr_y = particleY[jj];
 
                         float dx_scalar = q_curr_x - p_curr_x;
                         float dy_scalar = q_curr_y - p_curr_y;
@@ -412,28 +1527,7 @@ extern "C" {
 
                         // Only diffuse colors if particles are close enough (same threshold as push apart)
                         if (dist2 < minDist2 && dist2 > 1e-12f) { // Note: Using < minDist2 here
-                            // Load current colors for particle ii and jj
-                            float32x4_t pColor_vec = vld1q_f32(&particleColor_param[pColorIdx]);
-                            float32x4_t qColor_vec = vld1q_f32(&particleColor_param[qColorIdx]);
-
-                            // Calculate average color
-                            float32x4_t avg_color_vec = vmulq_n_f32(vaddq_f32(pColor_vec, qColor_vec), 0.5f);
-
-                            // Apply diffusion: new_color = old_color + (avg_color - old_color) * coeff
-                            // p_new = p_old + (avg - p_old) * coeff  => vmlaq_n_f32(p_old, vsubq_f32(avg, p_old), coeff)
-                            pColor_vec = vmlaq_n_f32(pColor_vec, vsubq_f32(avg_color_vec, pColor_vec), colorDiffusionCoeff_param);
-                            qColor_vec = vmlaq_n_f32(qColor_vec, vsubq_f32(avg_color_vec, qColor_vec), colorDiffusionCoeff_param);
-                            
-                            // Clamp colors to [0,1] after diffusion
-                            const float32x4_t zero_vec = vdupq_n_f32(0.0f);
-                            const float32x4_t one_vec = vdupq_n_f32(1.0f);
-
-                            pColor_vec = vmaxq_f32(zero_vec, vminq_f32(pColor_vec, one_vec));
-                            qColor_vec = vmaxq_f32(zero_vec, vminq_f32(qColor_vec, one_vec));
-
-                            // Store updated colors
-                            vst1q_f32(&particleColor_param[pColorIdx], pColor_vec);
-                            vst1q_f32(&particleColor_param[qColorIdx], qColor_vec);
+                            diffusePairGrade_native(particleGrade_param, ii, jj, colorDiffusionCoeff_param);
                         }
                     }
                 }
@@ -447,7 +1541,9 @@ extern "C" {
     }
 
     // Removed __attribute__ for broader compatibility
-    void transferVelocities_native(
+    // Internal: the grid fields must be SimArena fields (padded to whole lines, with
+    // the ghost column before cellType), so this is not part of the exported ABI.
+    static void transferVelocities_native(
         bool toGrid, float flipRatio,
         // Grid data
         float* u, float* v, float* du, float* dv,
@@ -455,14 +1551,15 @@ extern "C" {
         int32_t* cellType, // Written in P->G, read in G->P
         const float* s,    // Read only
         // Particle data
-        const float* particlePos, // Read only
-        float* particleVel,       // Written in G->P, read in P->G
+        const float* particleX, const float* particleY, // Read only
+        float* particleVelX, float* particleVelY,       // Written in G->P, read in P->G
         // Grid parameters
         int fNumX, int fNumY, float h, float invH,
         // Particle parameters
-        int numParticles
+        int numParticles,
+        FluidCellRuns* fluidRuns, // Rebuilt in P->G (may be nullptr: local scratch)
+        TransferScratch* scratch // Per-thread P->G grids / G->P masks (may be nullptr: local scratch)
     ) {
-        omp_set_num_threads(2); // Limit threads for thermal management (Phase 4)
         const int n = fNumY; // Stride
         const int fNumCells = fNumX * fNumY;
         const float hh = h; // Alias for clarity
@@ -471,25 +1568,20 @@ extern "C" {
         if (toGrid) {
             // --- P->G Transfer ---
 
-            // 1. Backup grid velocities and clear current/delta velocities (Vectorized + OpenMP)
-            const float32x4_t zero_vec = vdupq_n_f32(0.0f);
-            #pragma omp parallel for schedule(static)
-            for (int i = 0; i <= fNumCells - 4; i += 4) {
-                float32x4_t u_vec = vld1q_f32(&u[i]);
-                float32x4_t v_vec = vld1q_f32(&v[i]);
-                vst1q_f32(&prevU[i], u_vec);
-                vst1q_f32(&prevV[i], v_vec);
-                vst1q_f32(&du[i], zero_vec);
-                vst1q_f32(&dv[i], zero_vec);
-                vst1q_f32(&u[i], zero_vec);
-                vst1q_f32(&v[i], zero_vec);
-            }
-            // Scalar remainder (can be parallel too, less impact)
+            // 1. Backup grid velocities and clear current/delta velocities (Vectorized + OpenMP).
+            //    Grid fields are arena fields padded to whole lines, so no remainder loop.
+            //    Padding is a whole number of cache lines, so float8 steps fit exactly.
+            const simd::float4 zero_vec = simd::splat(0.0f);
+            const int paddedCells = static_cast<int>(paddedFieldCount(fNumCells));
             #pragma omp parallel for schedule(static)
-            for (int i = fNumCells - (fNumCells % 4); i < fNumCells; ++i) {
-                prevU[i] = u[i]; prevV[i] = v[i];
-                du[i] = 0.0f; dv[i] = 0.0f;
-                u[i] = 0.0f; v[i] = 0.0f;
+            for (int i = 0; i < paddedCells; i += 8) {
+                const simd::float8 zero8 = simd::splat8(0.0f);
+                simd::store(&prevU[i], simd::load8(&u[i]));
+                simd::store(&prevV[i], simd::load8(&v[i]));
+                simd::store(&du[i], zero8);
+                simd::store(&dv[i], zero8);
+                simd::store(&u[i], zero8);
+                simd::store(&v[i], zero8);
             }
 
             // 2. Initialize cell types (Solid based on s, rest Air) (OpenMP)
@@ -498,78 +1590,157 @@ extern "C" {
                 cellType[i] = (s[i] == 0.0f ? SOLID_CELL_CPP : AIR_CELL_CPP);
             }
 
-            // 3. Mark cells containing particles as Fluid (Keep serial - potential races on cellType write)
-            for (int i = 0; i < numParticles; ++i) {
-                const float px = particlePos[2 * i];
-                const float py = particlePos[2 * i + 1];
-                const int xi = static_cast<int>(clamp_cpp(floorf(px * invH), 0.0f, static_cast<float>(fNumX - 1)));
-                const int yi = static_cast<int>(clamp_cpp(floorf(py * invH), 0.0f, static_cast<float>(fNumY - 1)));
-                const int c = xi * n + yi;
-                if (c >= 0 && c < fNumCells && cellType[c] == AIR_CELL_CPP) {
-                    cellType[c] = FLUID_CELL_CPP;
-                }
-            }
-
-            // 4. Transfer particle velocities to grid (Keep serial - accumulation race condition)
-            for (int comp = 0; comp < 2; ++comp) {
-                // (Logic identical to _vectorized - scalar interpolation per particle)
-                const float dx_offset = (comp == 0 ? 0.0f : h2);
-                const float dy_offset = (comp == 0 ? h2 : 0.0f);
-                float* f_arr = (comp == 0 ? u : v);
-                float* df_arr = (comp == 0 ? du : dv);
-                const float clamp_max_x_val = static_cast<float>(fNumX - 1) * hh;
-                const float clamp_max_y_val = static_cast<float>(fNumY - 1) * hh;
-                const float grid_max_idx_f_x_val = static_cast<float>(fNumX - 2);
-                const float grid_max_idx_f_y_val = static_cast<float>(fNumY - 2);
-
+            // 3+4. Mark fluid cells and scatter particle velocities (OpenMP).
+            //    Each thread takes a static block of particles and accumulates into its
+            //    own grid, so the sums are race-free and, for a fixed thread count,
+            //    bit-stable. Fluid marking only ever writes FLUID over AIR (decided
+            //    from s, not from the racing cellType), so it needs no private copy.
+            FluidCellRuns localRuns;
+            if (fluidRuns == nullptr) fluidRuns = &localRuns;
+            TransferScratch localScratch;
+            if (scratch == nullptr) scratch = &localScratch;
+            TransferScratch* p2gScratch = scratch;
+            const int maxThreads = omp_get_max_threads();
+            if (p2gScratch->numThreads < maxThreads || p2gScratch->fNumCells != fNumCells || p2gScratch->fNumX != fNumX) {
+                p2gScratch->numThreads = maxThreads;
+                p2gScratch->fNumCells = fNumCells;
+                p2gScratch->fNumX = fNumX;
+                for (std::vector<float>* field : { &p2gScratch->u, &p2gScratch->v, &p2gScratch->du, &p2gScratch->dv }) {
+                    field->assign(static_cast<size_t>(maxThreads) * fNumCells, 0.0f);
+                }
+            }
+            p2gScratch->occupiedLo.assign(static_cast<size_t>(p2gScratch->numThreads) * fNumX, fNumY);
+            p2gScratch->occupiedHi.assign(static_cast<size_t>(p2gScratch->numThreads) * fNumX, -1);
+
+            const float clamp_max_x_val = static_cast<float>(fNumX - 1) * hh;
+            const float clamp_max_y_val = static_cast<float>(fNumY - 1) * hh;
+            const float grid_max_idx_f_x_val = static_cast<float>(fNumX - 2);
+            const float grid_max_idx_f_y_val = static_cast<float>(fNumY - 2);
+            int usedThreads = 1;
+
+            #pragma omp parallel
+            {
+                const int t = omp_get_thread_num();
+                #pragma omp single
+                usedThreads = omp_get_num_threads();
+
+                float* tu = p2gScratch->u.data() + static_cast<size_t>(t) * fNumCells;
+                float* tv = p2gScratch->v.data() + static_cast<size_t>(t) * fNumCells;
+                float* tdu = p2gScratch->du.data() + static_cast<size_t>(t) * fNumCells;
+                float* tdv = p2gScratch->dv.data() + static_cast<size_t>(t) * fNumCells;
+                int32_t* tOccLo = p2gScratch->occupiedLo.data() + static_cast<size_t>(t) * fNumX;
+                int32_t* tOccHi = p2gScratch->occupiedHi.data() + static_cast<size_t>(t) * fNumX;
+
+                #pragma omp for schedule(static)
                 for (int i = 0; i < numParticles; ++i) {
-                    float val_px_orig = particlePos[2 * i];
-                    float val_py_orig = particlePos[2 * i + 1];
-                    float px_clamped = fmaxf(hh, fminf(val_px_orig, clamp_max_x_val));
-                    float py_clamped = fmaxf(hh, fminf(val_py_orig, clamp_max_y_val));
-                    float fx = (px_clamped - dx_offset) * invH;
-                    float fy = (py_clamped - dy_offset) * invH;
-                    const int x0 = static_cast<int>(fminf(floorf(fx), grid_max_idx_f_x_val));
-                    const int y0 = static_cast<int>(fminf(floorf(fy), grid_max_idx_f_y_val));
-                    float tx = fx - static_cast<float>(x0);
-                    float ty = fy - static_cast<float>(y0);
-                    float sx = 1.0f - tx; float sy = 1.0f - ty;
-                    const float w0 = sx * sy, w1 = tx * sy, w2 = tx * ty, w3 = sx * ty;
-                    const int x1 = x0 + 1; const int y1 = y0 + 1;
-                    const int n0 = x0 * n + y0, n1 = x1 * n + y0, n2 = x1 * n + y1, n3 = x0 * n + y1;
-                    const float pv = particleVel[2 * i + comp];
-                    if (n0 >= 0 && n0 < fNumCells) { f_arr[n0] += pv * w0; df_arr[n0] += w0; }
-                    if (n1 >= 0 && n1 < fNumCells) { f_arr[n1] += pv * w1; df_arr[n1] += w1; }
-                    if (n2 >= 0 && n2 < fNumCells) { f_arr[n2] += pv * w2; df_arr[n2] += w2; }
-                    if (n3 >= 0 && n3 < fNumCells) { f_arr[n3] += pv * w3; df_arr[n3] += w3; }
+                    const float px = particleX[i];
+                    const float py = particleY[i];
+                    const int xi = static_cast<int>(clamp_cpp(floorf(px * invH), 0.0f, static_cast<float>(fNumX - 1)));
+                    const int yi = static_cast<int>(clamp_cpp(floorf(py * invH), 0.0f, static_cast<float>(fNumY - 1)));
+                    const int c = xi * n + yi;
+                    if (s[c] != 0.0f) {
+                        #pragma omp atomic write
+                        cellType[c] = FLUID_CELL_CPP;
+                    }
+                    tOccLo[xi] = std::min(tOccLo[xi], yi);
+                    tOccHi[xi] = std::max(tOccHi[xi], yi);
+
+                    // (Logic identical to _vectorized - scalar interpolation per particle, both components)
+                    const float px_clamped = fmaxf(hh, fminf(px, clamp_max_x_val));
+                    const float py_clamped = fmaxf(hh, fminf(py, clamp_max_y_val));
+                    // The scatter below starts from the clamped position, whose cell can differ
+                    // from (xi, yi) for particles within h of the grid edge. Its 3x3 neighbourhood
+                    // holds every face written, so occupying it keeps the dilated spans (and the
+                    // reduce / clear in step 5) covering all weight this thread deposits.
+                    const int xc = static_cast<int>(px_clamped * invH); // >= 1, truncation == floor
+                    const int yc = static_cast<int>(py_clamped * invH);
+                    tOccLo[xc] = std::min(tOccLo[xc], yc);
+                    tOccHi[xc] = std::max(tOccHi[xc], yc);
+                    for (int comp = 0; comp < 2; ++comp) {
+                        const float dx_offset = (comp == 0 ? 0.0f : h2);
+                        const float dy_offset = (comp == 0 ? h2 : 0.0f);
+                        float* f_arr = (comp == 0 ? tu : tv);
+                        float* df_arr = (comp == 0 ? tdu : tdv);
+                        float fx = (px_clamped - dx_offset) * invH;
+                        float fy = (py_clamped - dy_offset) * invH;
+                        const int x0 = static_cast<int>(fminf(floorf(fx), grid_max_idx_f_x_val));
+                        const int y0 = static_cast<int>(fminf(floorf(fy), grid_max_idx_f_y_val));
+                        float tx = fx - static_cast<float>(x0);
+                        float ty = fy - static_cast<float>(y0);
+                        float sx = 1.0f - tx; float sy = 1.0f - ty;
+                        const float w0 = sx * sy, w1 = tx * sy, w2 = tx * ty, w3 = sx * ty;
+                        const int x1 = x0 + 1; const int y1 = y0 + 1;
+                        const int n0 = x0 * n + y0, n1 = x1 * n + y0, n2 = x1 * n + y1, n3 = x0 * n + y1;
+                        const float pv = (comp == 0 ? particleVelX : particleVelY)[i];
+                        // x0 <= fNumX - 2 and y0 <= fNumY - 2, so all four corners are in the grid
+                        f_arr[n0] += pv * w0; df_arr[n0] += w0;
+                        f_arr[n1] += pv * w1; df_arr[n1] += w1;
+                        f_arr[n2] += pv * w2; df_arr[n2] += w2;
+                        f_arr[n3] += pv * w3; df_arr[n3] += w3;
+                    }
                 }
             }
 
-            // 5. Normalize grid velocities (Vectorized + OpenMP)
-            const float32x4_t epsilon_vec = vdupq_n_f32(1e-9f);
-            #pragma omp parallel for schedule(static)
-            for (int i = 0; i <= fNumCells - 4; i += 4) {
-                float32x4_t u_vec = vld1q_f32(&u[i]); float32x4_t v_vec = vld1q_f32(&v[i]);
-                float32x4_t du_vec = vld1q_f32(&du[i]); float32x4_t dv_vec = vld1q_f32(&dv[i]);
-                uint32x4_t u_mask = vcgtq_f32(du_vec, epsilon_vec);
-                float32x4_t u_divisor = vbslq_f32(u_mask, du_vec, vdupq_n_f32(1.0f));
-                float32x4_t u_inv_divisor_est = vrecpeq_f32(u_divisor);
-                float32x4_t u_inv_divisor_refined = vmulq_f32(vrecpsq_f32(u_divisor, u_inv_divisor_est), u_inv_divisor_est);
-                float32x4_t u_div_result = vmulq_f32(u_vec, u_inv_divisor_refined);
-                float32x4_t u_result = vbslq_f32(u_mask, u_div_result, zero_vec);
-                uint32x4_t v_mask = vcgtq_f32(dv_vec, epsilon_vec);
-                float32x4_t v_divisor = vbslq_f32(v_mask, dv_vec, vdupq_n_f32(1.0f));
-                float32x4_t v_inv_divisor_est = vrecpeq_f32(v_divisor);
-                float32x4_t v_inv_divisor_refined = vmulq_f32(vrecpsq_f32(v_divisor, v_inv_divisor_est), v_inv_divisor_est);
-                float32x4_t v_div_result = vmulq_f32(v_vec, v_inv_divisor_refined);
-                float32x4_t v_result = vbslq_f32(v_mask, v_div_result, zero_vec);
-                vst1q_f32(&u[i], u_result); vst1q_f32(&v[i], v_result);
-            }
-            // Scalar remainder (can be parallel)
+            // Merge the per-thread occupancy and build the fluid runs / active spans
+            fluidRuns->occupiedLo.assign(fNumX, fNumY);
+            fluidRuns->occupiedHi.assign(fNumX, -1);
+            for (int t = 0; t < usedThreads; ++t) {
+                for (int i = 0; i < fNumX; ++i) {
+                    fluidRuns->occupiedLo[i] = std::min(fluidRuns->occupiedLo[i], p2gScratch->occupiedLo[t * fNumX + i]);
+                    fluidRuns->occupiedHi[i] = std::max(fluidRuns->occupiedHi[i], p2gScratch->occupiedHi[t * fNumX + i]);
+                }
+            }
+            buildFluidCellRuns_native(cellType, fNumX, fNumY, true, fluidRuns);
+
+            // 5. Reduce the private grids in thread order and normalize (Vectorized + OpenMP).
+            //    Only the active spans can hold weight; faces outside them are already zero.
+            //    The private grids are cleared on the way so they are ready for the next call.
+            const simd::float4 epsilon_vec = simd::splat(1e-9f);
             #pragma omp parallel for schedule(static)
-            for (int i = fNumCells - (fNumCells % 4); i < fNumCells; ++i) {
-                u[i] = (du[i] > 1e-9f) ? (u[i] / du[i]) : 0.0f;
-                v[i] = (dv[i] > 1e-9f) ? (v[i] / dv[i]) : 0.0f;
+            for (int col = 0; col < fNumX; ++col) {
+                const int spanEnd = col * n + fluidRuns->spanHi[col];
+                int i = col * n + fluidRuns->spanLo[col];
+                for (; i <= spanEnd - 4; i += 4) {
+                    simd::float4 u_vec = zero_vec, v_vec = zero_vec, du_vec = zero_vec, dv_vec = zero_vec;
+                    for (int t = 0; t < usedThreads; ++t) {
+                        const size_t k = static_cast<size_t>(t) * fNumCells + i;
+                        u_vec = simd::add(u_vec, simd::load(&p2gScratch->u[k]));
+                        v_vec = simd::add(v_vec, simd::load(&p2gScratch->v[k]));
+                        du_vec = simd::add(du_vec, simd::load(&p2gScratch->du[k]));
+                        dv_vec = simd::add(dv_vec, simd::load(&p2gScratch->dv[k]));
+                        simd::store(&p2gScratch->u[k], zero_vec);
+                        simd::store(&p2gScratch->v[k], zero_vec);
+                        simd::store(&p2gScratch->du[k], zero_vec);
+                        simd::store(&p2gScratch->dv[k], zero_vec);
+                    }
+                    simd::store(&du[i], du_vec); simd::store(&dv[i], dv_vec);
+                    simd::mask4 u_mask = simd::cmpgt(du_vec, epsilon_vec);
+                    simd::float4 u_divisor = simd::select(u_mask, du_vec, simd::splat(1.0f));
+                    simd::float4 u_inv_divisor_est = simd::recipEstimate(u_divisor);
+                    simd::float4 u_inv_divisor_refined = simd::mul(simd::recipStep(u_divisor, u_inv_divisor_est), u_inv_divisor_est);
+                    simd::float4 u_div_result = simd::mul(u_vec, u_inv_divisor_refined);
+                    simd::float4 u_result = simd::select(u_mask, u_div_result, zero_vec);
+                    simd::mask4 v_mask = simd::cmpgt(dv_vec, epsilon_vec);
+                    simd::float4 v_divisor = simd::select(v_mask, dv_vec, simd::splat(1.0f));
+                    simd::float4 v_inv_divisor_est = simd::recipEstimate(v_divisor);
+                    simd::float4 v_inv_divisor_refined = simd::mul(simd::recipStep(v_divisor, v_inv_divisor_est), v_inv_divisor_est);
+                    simd::float4 v_div_result = simd::mul(v_vec, v_inv_divisor_refined);
+                    simd::float4 v_result = simd::select(v_mask, v_div_result, zero_vec);
+                    simd::store(&u[i], u_result); simd::store(&v[i], v_result);
+                }
+                for (; i < spanEnd; ++i) { // Scalar remainder
+                    float su = 0.0f, sv = 0.0f, sdu = 0.0f, sdv = 0.0f;
+                    for (int t = 0; t < usedThreads; ++t) {
+                        const size_t k = static_cast<size_t>(t) * fNumCells + i;
+                        su += p2gScratch->u[k]; sv += p2gScratch->v[k];
+                        sdu += p2gScratch->du[k]; sdv += p2gScratch->dv[k];
+                        p2gScratch->u[k] = 0.0f; p2gScratch->v[k] = 0.0f;
+                        p2gScratch->du[k] = 0.0f; p2gScratch->dv[k] = 0.0f;
+                    }
+                    du[i] = sdu; dv[i] = sdv;
+                    u[i] = (sdu > 1e-9f) ? (su / sdu) : 0.0f;
+                    v[i] = (sdv > 1e-9f) ? (sv / sdv) : 0.0f;
+                }
             }
 
             // 6. Restore solid cell velocities (using prevU/prevV) (OpenMP)
@@ -577,47 +1748,120 @@ extern "C" {
             for (int i = 0; i < fNumX; i++) {
                 for (int j = 0; j < fNumY; j++) {
                     const int idx = i * n + j;
-                    if (idx < 0 || idx >= fNumCells) continue;
                     const bool solidCurrent = (cellType[idx] == SOLID_CELL_CPP);
-                    const int leftCellIdx = (i > 0) ? (i - 1) * n + j : -1;
-                    bool solidLeft = (i > 0 && leftCellIdx >= 0 && leftCellIdx < fNumCells && cellType[leftCellIdx] == SOLID_CELL_CPP);
-                    if (solidCurrent || solidLeft) { if (idx < fNumCells) u[idx] = prevU[idx]; }
-                    const int bottomCellIdx = (j > 0) ? i * n + (j - 1) : -1;
-                    bool solidBottom = (j > 0 && bottomCellIdx >= 0 && bottomCellIdx < fNumCells && cellType[bottomCellIdx] == SOLID_CELL_CPP);
-                    if (solidCurrent || solidBottom) { if (idx < fNumCells) v[idx] = prevV[idx]; }
+                    const bool solidLeft = (cellType[idx - n] == SOLID_CELL_CPP); // AIR ghost column for i == 0
+                    if (solidCurrent || solidLeft) u[idx] = prevU[idx];
+                    const bool solidBottom = (j > 0 && cellType[idx - 1] == SOLID_CELL_CPP);
+                    if (solidCurrent || solidBottom) v[idx] = prevV[idx];
                 }
             }
 
         } else {
-            // --- G->P Transfer (Keep serial - potential races on particleVel write) ---
-            const int n_stride = n; // For lambda capture
-
-             // Define validity check lambda (logic from previous fix)
-            auto isValidVelocitySample =
-                [&](int sample_idx, int component) -> bool {
-                if (sample_idx < 0 || sample_idx >= fNumCells) return false;
-                int neighbor_idx_offset = (component == 0) ? n_stride : 1;
-                int neighbor_idx = sample_idx - neighbor_idx_offset;
-                bool sample_cell_ok = (cellType[sample_idx] != AIR_CELL_CPP);
-                bool neighbor_cell_ok = (neighbor_idx >= 0 && neighbor_idx < fNumCells && cellType[neighbor_idx] != AIR_CELL_CPP);
-                return sample_cell_ok || neighbor_cell_ok;
-            };
+            // --- G->P Transfer (OpenMP + SIMD, 4 particles per iteration, both components) ---
+            // Each particle only writes its own particleVelX/Y entries, so particles are independent.
+            TransferScratch localScratch;
+            if (scratch == nullptr) scratch = &localScratch;
+            scratch->validU.resize(fNumCells);
+            scratch->validV.resize(fNumCells);
+            float* validU = scratch->validU.data();
+            float* validV = scratch->validV.data();
+
+            // 1. Face validity: the sample cell or its left (u) / bottom (v) neighbour is not AIR.
+            //    Neighbours are taken in flat index space, exactly like the old per-sample check;
+            //    reads before cell 0 land in the arena's AIR ghost column.
+            #pragma omp parallel for schedule(static)
+            for (int idx = 0; idx < fNumCells; ++idx) {
+                const bool sampleOk = cellType[idx] != AIR_CELL_CPP;
+                validU[idx] = (sampleOk || cellType[idx - n] != AIR_CELL_CPP) ? 1.0f : 0.0f;
+                validV[idx] = (sampleOk || cellType[idx - 1] != AIR_CELL_CPP) ? 1.0f : 0.0f;
+            }
 
-            for (int comp = 0; comp < 2; ++comp) {
-                 // (Logic identical to _vectorized / previous fix - scalar interpolation per particle)
-                const float dx_offset = (comp == 0 ? 0.0f : h2);
-                const float dy_offset = (comp == 0 ? h2 : 0.0f);
-                const float* f_arr = (comp == 0) ? u : v;
-                const float* prevF_arr = (comp == 0) ? prevU : prevV;
-                const float clamp_max_x_val = static_cast<float>(fNumX - 1) * hh;
-                const float clamp_max_y_val = static_cast<float>(fNumY - 1) * hh;
-                const float grid_max_idx_f_x_val = static_cast<float>(fNumX - 2);
-                const float grid_max_idx_f_y_val = static_cast<float>(fNumY - 2);
+            const float clamp_max_x_val = static_cast<float>(fNumX - 1) * hh;
+            const float clamp_max_y_val = static_cast<float>(fNumY - 1) * hh;
+            const float grid_max_idx_f_x_val = static_cast<float>(fNumX - 2);
+            const float grid_max_idx_f_y_val = static_cast<float>(fNumY - 2);
 
-                for (int i = 0; i < numParticles; ++i) {
-                    float px_orig = particlePos[2*i]; float py_orig = particlePos[2*i+1];
-                    float px_clamped = fmaxf(hh, fminf(px_orig, clamp_max_x_val));
-                    float py_clamped = fmaxf(hh, fminf(py_orig, clamp_max_y_val));
+            // 2. Vectorized gather. Positions are clamped to >= h, so every fx, fy is positive and
+            //    truncation equals floor; the clamps also keep all four samples inside the grid.
+            const int numGroups = numParticles / 4;
+            #pragma omp parallel for schedule(static)
+            for (int g = 0; g < numGroups; ++g) {
+                const int first = 4 * g;
+                const simd::float4 h_vec = simd::splat(hh);
+                const simd::float4 invH_vec = simd::splat(invH);
+                const simd::float4 one_vec = simd::splat(1.0f);
+                const simd::float4 flip_vec = simd::splat(flipRatio);
+                const simd::float4 pic_vec = simd::splat(1.0f - flipRatio);
+                const simd::int4 stride_vec = simd::splatInt(n);
+                const simd::int4 one_s32 = simd::splatInt(1);
+
+                simd::float4 vel[2] = { simd::load(&particleVelX[first]), simd::load(&particleVelY[first]) };
+                const simd::float4 px = simd::max(h_vec, simd::min(simd::load(&particleX[first]), simd::splat(clamp_max_x_val)));
+                const simd::float4 py = simd::max(h_vec, simd::min(simd::load(&particleY[first]), simd::splat(clamp_max_y_val)));
+
+                for (int comp = 0; comp < 2; ++comp) {
+                    const float* f_arr = (comp == 0) ? u : v;
+                    const float* prevF_arr = (comp == 0) ? prevU : prevV;
+                    const float* valid = (comp == 0) ? validU : validV;
+                    const simd::float4 fx = simd::mul(simd::sub(px, simd::splat(comp == 0 ? 0.0f : h2)), invH_vec);
+                    const simd::float4 fy = simd::mul(simd::sub(py, simd::splat(comp == 0 ? h2 : 0.0f)), invH_vec);
+                    const simd::int4 x0 = simd::min(simd::toInt(fx), simd::splatInt(static_cast<int>(grid_max_idx_f_x_val)));
+                    const simd::int4 y0 = simd::min(simd::toInt(fy), simd::splatInt(static_cast<int>(grid_max_idx_f_y_val)));
+                    const simd::float4 tx = simd::sub(fx, simd::toFloat(x0));
+                    const simd::float4 ty = simd::sub(fy, simd::toFloat(y0));
+                    const simd::float4 sx = simd::sub(one_vec, tx);
+                    const simd::float4 sy = simd::sub(one_vec, ty);
+
+                    int32_t nIdx[4][4]; // [corner][lane]
+                    const simd::int4 n0 = simd::madd(y0, x0, stride_vec);
+                    const simd::int4 n1 = simd::add(n0, stride_vec);
+                    simd::store(nIdx[0], n0);
+                    simd::store(nIdx[1], n1);
+                    simd::store(nIdx[2], simd::add(n1, one_s32));
+                    simd::store(nIdx[3], simd::add(n0, one_s32));
+
+                    // Validity-weighted bilinear weights, corners in the usual 0..3 order
+                    simd::float4 w[4];
+                    w[0] = simd::mul(sx, sy);
+                    w[1] = simd::mul(tx, sy);
+                    w[2] = simd::mul(tx, ty);
+                    w[3] = simd::mul(sx, ty);
+                    simd::float4 sumW = simd::splat(0.0f);
+                    simd::float4 picSum = simd::splat(0.0f);
+                    simd::float4 corrSum = simd::splat(0.0f);
+                    for (int k = 0; k < 4; ++k) {
+                        const simd::float4 vw = simd::mul(simd::gather(valid, nIdx[k]), w[k]);
+                        const simd::float4 f = simd::gather(f_arr, nIdx[k]);
+                        const simd::float4 pf = simd::gather(prevF_arr, nIdx[k]);
+                        sumW = simd::add(sumW, vw);
+                        picSum = simd::madd(picSum, vw, f);
+                        corrSum = simd::madd(corrSum, vw, simd::sub(f, pf));
+                    }
+
+                    const simd::mask4 has_mask = simd::cmpgt(sumW, simd::splat(1e-9f));
+                    const simd::float4 divisor = simd::select(has_mask, sumW, one_vec);
+                    simd::float4 inv = simd::recipEstimate(divisor);
+                    inv = simd::mul(simd::recipStep(divisor, inv), inv);
+                    inv = simd::mul(simd::recipStep(divisor, inv), inv);
+                    const simd::float4 picV = simd::mul(picSum, inv);
+                    const simd::float4 flipV = simd::madd(vel[comp], corrSum, inv);
+                    const simd::float4 blended = simd::madd(simd::mul(pic_vec, picV), flip_vec, flipV);
+                    vel[comp] = simd::select(has_mask, blended, vel[comp]);
+                }
+                simd::store(&particleVelX[first], vel[0]);
+                simd::store(&particleVelY[first], vel[1]);
+            }
+
+            // 3. Scalar remainder (fewer than 4 particles)
+            for (int i = 4 * numGroups; i < numParticles; ++i) {
+                const float px_clamped = fmaxf(hh, fminf(particleX[i], clamp_max_x_val));
+                const float py_clamped = fmaxf(hh, fminf(particleY[i], clamp_max_y_val));
+                for (int comp = 0; comp < 2; ++comp) {
+                    const float* f_arr = (comp == 0) ? u : v;
+                    const float* prevF_arr = (comp == 0) ? prevU : prevV;
+                    const float* valid = (comp == 0) ? validU : validV;
+                    const float dx_offset = (comp == 0 ? 0.0f : h2);
+                    const float dy_offset = (comp == 0 ? h2 : 0.0f);
                     float fx = (px_clamped - dx_offset) * invH;
                     float fy = (py_clamped - dy_offset) * invH;
                     const int x0 = static_cast<int>(fminf(floorf(fx), grid_max_idx_f_x_val));
@@ -625,34 +1869,17 @@ extern "C" {
                     float tx = fx - static_cast<float>(x0); float ty = fy - static_cast<float>(y0);
                     float sx = 1.0f - tx; float sy = 1.0f - ty;
                     const int x1 = x0 + 1; const int y1 = y0 + 1;
-                    const float w0 = sx * sy, w1 = tx * sy, w2 = tx * ty, w3 = sx * ty;
                     const int n0 = x0 * n + y0, n1 = x1 * n + y0, n2 = x1 * n + y1, n3 = x0 * n + y1;
-
-                    float v0ok = 0.0f, v1ok = 0.0f, v2ok = 0.0f, v3ok = 0.0f;
-                     // Use validity check lambda
-                    if (n0 >= 0 && n0 < fNumCells) v0ok = isValidVelocitySample(n0, comp) ? 1.0f : 0.0f;
-                    if (n1 >= 0 && n1 < fNumCells) v1ok = isValidVelocitySample(n1, comp) ? 1.0f : 0.0f;
-                    if (n2 >= 0 && n2 < fNumCells) v2ok = isValidVelocitySample(n2, comp) ? 1.0f : 0.0f;
-                    if (n3 >= 0 && n3 < fNumCells) v3ok = isValidVelocitySample(n3, comp) ? 1.0f : 0.0f;
-
-                    const float sumW = v0ok * w0 + v1ok * w1 + v2ok * w2 + v3ok * w3;
-
+                    const float w0 = valid[n0] * sx * sy, w1 = valid[n1] * tx * sy;
+                    const float w2 = valid[n2] * tx * ty, w3 = valid[n3] * sx * ty;
+                    const float sumW = w0 + w1 + w2 + w3;
                     if (sumW > 1e-9f) {
-                         // Safely access arrays only if index is valid (although lambda should prevent invalid indices)
-                        const float f0 = (n0 >= 0 && n0 < fNumCells) ? f_arr[n0] : 0.0f;
-                        const float f1 = (n1 >= 0 && n1 < fNumCells) ? f_arr[n1] : 0.0f;
-                        const float f2 = (n2 >= 0 && n2 < fNumCells) ? f_arr[n2] : 0.0f;
-                        const float f3 = (n3 >= 0 && n3 < fNumCells) ? f_arr[n3] : 0.0f;
-                        const float pf0 = (n0 >= 0 && n0 < fNumCells) ? prevF_arr[n0] : 0.0f;
-                        const float pf1 = (n1 >= 0 && n1 < fNumCells) ? prevF_arr[n1] : 0.0f;
-                        const float pf2 = (n2 >= 0 && n2 < fNumCells) ? prevF_arr[n2] : 0.0f;
-                        const float pf3 = (n3 >= 0 && n3 < fNumCells) ? prevF_arr[n3] : 0.0f;
-
-                        const float picV = (v0ok * w0 * f0 + v1ok * w1 * f1 + v2ok * w2 * f2 + v3ok * w3 * f3) / sumW;
-                        const float corr = (v0ok * w0 * (f0 - pf0) + v1ok * w1 * (f1 - pf1) +
-                                            v2ok * w2 * (f2 - pf2) + v3ok * w3 * (f3 - pf3)) / sumW;
-                        const float flipV = particleVel[2 * i + comp] + corr;
-                        particleVel[2 * i + comp] = (1.0f - flipRatio) * picV + flipRatio * flipV;
+                        const float picV = (w0 * f_arr[n0] + w1 * f_arr[n1] + w2 * f_arr[n2] + w3 * f_arr[n3]) / sumW;
+                        const float corr = (w0 * (f_arr[n0] - prevF_arr[n0]) + w1 * (f_arr[n1] - prevF_arr[n1]) +
+                                            w2 * (f_arr[n2] - prevF_arr[n2]) + w3 * (f_arr[n3] - prevF_arr[n3])) / sumW;
+                        float* particleVelComp = (comp == 0) ? particleVelX : particleVelY;
+                        const float flipV = particleVelComp[i] + corr;
+                        particleVelComp[i] = (1.0f - flipRatio) * picV + flipRatio * flipV;
                     }
                 }
             }
@@ -667,14 +1894,13 @@ extern "C" {
         float invH_param,
         int fNumX_param, int fNumY_param,
         float h_param,
-        const float* particlePos_param,
+        const float* particleX_param, const float* particleY_param,
         // const int32_t* cellType_param, // Was unused, removed
         // Outputs (modified in place via pointers)
         float* particleDensityGrid_param
         // float* particleColor_param, // REMOVED
         // bool enableDynamicColoring // REMOVED
     ) {
-        omp_set_num_threads(2); // Limit threads for thermal management (Phase 4)
         const int n_stride = fNumY_param; // Stride for grid
         const int fNumCells_param = fNumX_param * fNumY_param;
         const float hh_param = h_param; // Alias for clarity
@@ -689,8 +1915,8 @@ extern "C" {
 
         // Accumulate density (keep serial - accumulation race)
         for (int i = 0; i < numParticles; i++) {
-            float x = particlePos_param[2 * i];
-            float y = particlePos_param[2 * i + 1];
+            float x = particleX_param[i];
+            float y = particleY_param[i];
             
             x = clamp_cpp(x, hh_param, (fNumX_param - 1) * hh_param);
             y = clamp_cpp(y, hh_param, (fNumY_param - 1) * hh_param);
@@ -713,86 +1939,195 @@ extern "C" {
             int idx0 = x0 * n_stride + y0; int idx1 = x1 * n_stride + y0;
             int idx2 = x1 * n_stride + y1; int idx3 = x0 * n_stride + y1;
 
-            if(idx0 >= 0 && idx0 < fNumCells_param) particleDensityGrid_param[idx0] += sx * sy;
-            if(idx1 >= 0 && idx1 < fNumCells_param) particleDensityGrid_param[idx1] += tx * sy;
-            if(idx2 >= 0 && idx2 < fNumCells_param) particleDensityGrid_param[idx2] += tx * ty;
-            if(idx3 >= 0 && idx3 < fNumCells_param) particleDensityGrid_param[idx3] += sx * ty;
+            particleDensityGrid_param[idx0] += sx * sy;
+            particleDensityGrid_param[idx1] += tx * sy;
+            particleDensityGrid_param[idx2] += tx * ty;
+            particleDensityGrid_param[idx3] += sx * ty;
         }
         // Color update logic removed from this function
     } // End updateParticleDensityGrid_native
 
     // New function for dynamic particle color updates
+    // Fades every grade by GRADE_FADE (8 particles per SIMD saturating subtract),
+    // then resets particles in low-density cells to the highlight grade.
     void updateDynamicParticleColors_native(
         int numParticles,
         float particleRestDensity_param,
         float invH_param,
         int fNumX_param, int fNumY_param,
         float h_param,
-        const float* particlePos_param, // For cell index calculation
+        const float* particleX_param, const float* particleY_param, // For cell index calculation
         const float* particleDensityGrid_param, // Read-only, needed for relDensity
-        float* particleColor_param // Read & Written
+        uint16_t* particleGrade_param // Read & Written
     ) {
-        omp_set_num_threads(2); // Consistent threading
         const int n_stride = fNumY_param;
         const int fNumCells_param = fNumX_param * fNumY_param;
 
         // Logic from JS updateParticleColors / former part of updateParticleProperties_native
-        const float color_fade_s = 0.01f;
         const float low_density_threshold = 0.7f;
-        const float low_density_highlight_s = 0.8f;
+        const bool checkDensity = particleRestDensity_param > 1e-9f; // Ensure rest_density is valid
 
+        const int numGroups = (numParticles + 7) / 8;
         #pragma omp parallel for schedule(static)
-        for (int i = 0; i < numParticles; ++i) {
-            int baseColorIdx = 4 * i; // Changed for RGBA
-
-            // Load current color
-            float32x4_t color_vec = vld1q_f32(&particleColor_param[baseColorIdx]);
-
-            // Apply fading/shifting using NEON
-            // R fades down, G fades down, B fades up, A is preserved
-            float32x4_t fade_adjustments = vdupq_n_f32(0.0f); // Initialize all lanes to 0.0f
-            fade_adjustments = vsetq_lane_f32(color_fade_s, fade_adjustments, 0);    // Set lane 0 (for R adjustment)
-            fade_adjustments = vsetq_lane_f32(color_fade_s, fade_adjustments, 1);    // Set lane 1 (for G adjustment)
-            fade_adjustments = vsetq_lane_f32(-color_fade_s, fade_adjustments, 2);   // Set lane 2 (for B adjustment)
-                                                                                    // Lane 3 remains 0.0f (for A, no change in adjustment)
-            color_vec = vsubq_f32(color_vec, fade_adjustments);
-
-            // Clamp all components to [0.0, 1.0] using NEON
-            const float32x4_t zero_vec = vdupq_n_f32(0.0f);
-            const float32x4_t one_vec = vdupq_n_f32(1.0f);
-            color_vec = vmaxq_f32(zero_vec, vminq_f32(color_vec, one_vec));
-            
-            // Store faded and clamped color (will be overwritten if density reset occurs)
-            vst1q_f32(&particleColor_param[baseColorIdx], color_vec);
+        for (int g = 0; g < numGroups; ++g) {
+            const int first = 8 * g;
+            const int last = std::min(first + 8, numParticles);
+            if (last - first == 8) {
+                const simd::u16x8 grade = simd::load(&particleGrade_param[first]);
+                simd::store(&particleGrade_param[first], simd::subSaturate(grade, simd::splatU16(GRADE_FADE)));
+            } else { // Scalar remainder
+                for (int i = first; i < last; ++i) {
+                    const uint16_t grade = particleGrade_param[i];
+                    particleGrade_param[i] = grade > GRADE_FADE ? grade - GRADE_FADE : 0;
+                }
+            }
 
             // Apply density-based reset
-            if (particleRestDensity_param > 1e-9f) { // Ensure rest_density is valid
-                int xi = static_cast<int>(clamp_cpp(floorf(particlePos_param[2*i] * invH_param), 0.0f, static_cast<float>(fNumX_param - 1)));
-                int yi = static_cast<int>(clamp_cpp(floorf(particlePos_param[2*i+1] * invH_param), 0.0f, static_cast<float>(fNumY_param - 1)));
+            if (!checkDensity) continue;
+            for (int i = first; i < last; ++i) {
+                int xi = static_cast<int>(clamp_cpp(floorf(particleX_param[i] * invH_param), 0.0f, static_cast<float>(fNumX_param - 1)));
+                int yi = static_cast<int>(clamp_cpp(floorf(particleY_param[i] * invH_param), 0.0f, static_cast<float>(fNumY_param - 1)));
                 int cellIdx = xi * n_stride + yi;
-
-                if (cellIdx >= 0 && cellIdx < fNumCells_param) {
-                    float relDensity = particleDensityGrid_param[cellIdx] / particleRestDensity_param;
-                    if (relDensity < low_density_threshold) {
-                        // Set to highlight color {low_density_highlight_s, low_density_highlight_s, 1.0f, 1.0f} (RGBA)
-                        float32x4_t highlight_color_vec = vdupq_n_f32(0.0f); // Initialize all lanes
-                        highlight_color_vec = vsetq_lane_f32(low_density_highlight_s, highlight_color_vec, 0);
-                        highlight_color_vec = vsetq_lane_f32(low_density_highlight_s, highlight_color_vec, 1);
-                        highlight_color_vec = vsetq_lane_f32(1.0f, highlight_color_vec, 2);
-                        highlight_color_vec = vsetq_lane_f32(1.0f, highlight_color_vec, 3); // Alpha to 1.0f for highlight
-                        vst1q_f32(&particleColor_param[baseColorIdx], highlight_color_vec);
-                    }
+                if (cellIdx >= 0 && cellIdx < fNumCells_param &&
+                    particleDensityGrid_param[cellIdx] / particleRestDensity_param < low_density_threshold) {
+                    particleGrade_param[i] = GRADE_HIGHLIGHT;
                 }
             }
         }
     } // End updateDynamicParticleColors_native
 
 
+    // One parallel sweep over the SoA particles that optionally integrates (gravity
+    // + advection) and optionally resolves obstacle and wall collisions, 4 particles
+    // per SIMD iteration. Distances use the rsqrt estimate plus two Newton steps
+    // (armv7 has no vector sqrt/div); the scalar remainder keeps the original sqrtf
+    // formulation.
+    static void advanceParticles_native(
+        float* particleX, float* particleY, float* particleVelX, float* particleVelY,
+        int numParticles,
+        bool integrate, float dt, float gravityX, float gravityY,
+        bool collide, float particleRadius,
+        bool isObstacleActive, float obstacleX, float obstacleY, float obstacleRadius,
+        float obstacleVelX, float obstacleVelY,
+        float sceneCircleCenterX, float sceneCircleCenterY, float sceneCircleRadius
+    ) {
+        const float r = particleRadius;
+        const float obsInteractRadius = obstacleRadius + r;
+        const float obsInteractRadiusSq = obsInteractRadius * obsInteractRadius;
+        const float wallCollisionRadius = sceneCircleRadius - r;
+        const float wallCollisionRadiusSq = wallCollisionRadius * wallCollisionRadius;
+
+        const int numGroups = numParticles / 4;
+        #pragma omp parallel for schedule(static)
+        for (int g = 0; g < numGroups; ++g) {
+            const int i = 4 * g;
+            const simd::float4 eps_vec = simd::splat(1e-12f);
+            const simd::float4 one_vec = simd::splat(1.0f);
+            simd::float4 px = simd::load(&particleX[i]);
+            simd::float4 py = simd::load(&particleY[i]);
+            simd::float4 pvx = simd::load(&particleVelX[i]);
+            simd::float4 pvy = simd::load(&particleVelY[i]);
+
+            if (integrate) {
+                pvx = simd::add(pvx, simd::splat(dt * gravityX));
+                pvy = simd::add(pvy, simd::splat(dt * gravityY));
+                px = simd::madd(px, pvx, simd::splat(dt));
+                py = simd::madd(py, pvy, simd::splat(dt));
+            }
+
+            if (collide) {
+                if (isObstacleActive) {
+                    const simd::float4 dxObs = simd::sub(px, simd::splat(obstacleX));
+                    const simd::float4 dyObs = simd::sub(py, simd::splat(obstacleY));
+                    const simd::float4 d2Obs = simd::madd(simd::mul(dxObs, dxObs), dyObs, dyObs);
+                    const simd::mask4 hit = simd::maskAnd(simd::cmplt(d2Obs, simd::splat(obsInteractRadiusSq)), simd::cmpgt(d2Obs, eps_vec));
+                    const simd::float4 d2Safe = simd::select(hit, d2Obs, one_vec);
+                    simd::float4 invD = simd::rsqrtEstimate(d2Safe);
+                    invD = simd::mul(invD, simd::rsqrtStep(simd::mul(d2Safe, invD), invD));
+                    invD = simd::mul(invD, simd::rsqrtStep(simd::mul(d2Safe, invD), invD));
+                    // (d / |d|) * (R - |d|) = d * (R / |d| - 1)
+                    const simd::float4 scale = simd::sub(simd::mul(simd::splat(obsInteractRadius), invD), one_vec);
+                    px = simd::select(hit, simd::madd(px, dxObs, scale), px);
+                    py = simd::select(hit, simd::madd(py, dyObs, scale), py);
+                    pvx = simd::select(hit, simd::splat(obstacleVelX), pvx);
+                    pvy = simd::select(hit, simd::splat(obstacleVelY), pvy);
+                }
+
+                const simd::float4 dxWall = simd::sub(px, simd::splat(sceneCircleCenterX));
+                const simd::float4 dyWall = simd::sub(py, simd::splat(sceneCircleCenterY));
+                const simd::float4 d2Wall = simd::madd(simd::mul(dxWall, dxWall), dyWall, dyWall);
+                const simd::mask4 out = simd::maskAnd(simd::cmpgt(d2Wall, simd::splat(wallCollisionRadiusSq)), simd::cmpgt(d2Wall, eps_vec));
+                const simd::float4 d2Safe = simd::select(out, d2Wall, one_vec);
+                simd::float4 invD = simd::rsqrtEstimate(d2Safe);
+                invD = simd::mul(invD, simd::rsqrtStep(simd::mul(d2Safe, invD), invD));
+                invD = simd::mul(invD, simd::rsqrtStep(simd::mul(d2Safe, invD), invD));
+                // (d / |d|) * (|d| - R) = d * (1 - R / |d|)
+                const simd::float4 scale = simd::msub(one_vec, simd::splat(wallCollisionRadius), invD);
+                px = simd::select(out, simd::msub(px, dxWall, scale), px);
+                py = simd::select(out, simd::msub(py, dyWall, scale), py);
+                pvx = simd::select(out, simd::splat(0.0f), pvx);
+                pvy = simd::select(out, simd::splat(0.0f), pvy);
+            }
+
+            simd::store(&particleX[i], px);
+            simd::store(&particleY[i], py);
+            simd::store(&particleVelX[i], pvx);
+            simd::store(&particleVelY[i], pvy);
+        }
+
+        // Scalar remainder (fewer than 4 particles)
+        for (int i = 4 * numGroups; i < numParticles; i++) {
+            float px = particleX[i];
+            float py = particleY[i];
+            float pvx = particleVelX[i];
+            float pvy = particleVelY[i];
+
+            if (integrate) {
+                pvx += dt * gravityX;
+                pvy += dt * gravityY;
+                px += pvx * dt;
+                py += pvy * dt;
+            }
+
+            if (collide) {
+                if (isObstacleActive) {
+                    const float dxObs = px - obstacleX;
+                    const float dyObs = py - obstacleY;
+                    const float d2Obs = dxObs * dxObs + dyObs * dyObs;
+                    if (d2Obs < obsInteractRadiusSq && d2Obs > 1e-12f) {
+                        const float dObs = sqrtf(d2Obs);
+                        const float overlapObs = obsInteractRadius - dObs;
+                        px += (dxObs / dObs) * overlapObs;
+                        py += (dyObs / dObs) * overlapObs;
+                        pvx = obstacleVelX;
+                        pvy = obstacleVelY;
+                    }
+                }
+
+                const float dxWall = px - sceneCircleCenterX;
+                const float dyWall = py - sceneCircleCenterY;
+                const float distSqToWallCenter = dxWall * dxWall + dyWall * dyWall;
+                if (distSqToWallCenter > wallCollisionRadiusSq && distSqToWallCenter > 1e-12f) {
+                    const float distToWallCenter = sqrtf(distSqToWallCenter);
+                    const float overlapWall = distToWallCenter - wallCollisionRadius;
+                    px -= (dxWall / distToWallCenter) * overlapWall;
+                    py -= (dyWall / distToWallCenter) * overlapWall;
+                    pvx = 0.0f;
+                    pvy = 0.0f;
+                }
+            }
+            particleX[i] = px;
+            particleY[i] = py;
+            particleVelX[i] = pvx;
+            particleVelY[i] = pvy;
+        }
+    }
+
     // __attribute__((visibility("default"))) __attribute__((used)) // Removed for broader compatibility
     void handleCollisions_native(
         // Inputs / Outputs (modified in place)
-        float* particlePos_param,     // Read & Written
-        float* particleVel_param,     // Read & Written
+        float* particleX_param, float* particleY_param,       // Read & Written
+        float* particleVelX_param, float* particleVelY_param, // Read & Written
         // Inputs
         int numParticles,
         float particleRadius_param,
@@ -808,51 +2143,1251 @@ extern "C" {
         float sceneCircleCenterY_param,
         float sceneCircleRadius_param
     ) {
-        omp_set_num_threads(2); // Limit threads for thermal management (Phase 4)
-        const float r = particleRadius_param;
-        const float obsInteractRadius = obstacleRadius_param + r;
-        const float obsInteractRadiusSq = obsInteractRadius * obsInteractRadius;
-        const float wallCollisionRadius = sceneCircleRadius_param - r;
+        advanceParticles_native(
+            particleX_param, particleY_param, particleVelX_param, particleVelY_param, numParticles,
+            false, 0.0f, 0.0f, 0.0f,
+            true, particleRadius_param,
+            isObstacleActive_param, obstacleX_param, obstacleY_param, obstacleRadius_param,
+            obstacleVelX_param, obstacleVelY_param,
+            sceneCircleCenterX_param, sceneCircleCenterY_param, sceneCircleRadius_param);
+    } // End handleCollisions_native
+
+
+    // ===================================================================
+    // Persistent simulation context API
+    // ===================================================================
+
+    // Counting sort of particles into the particle grid (ported from Dart _stepOnce)
+    // Parallel counting sort of the particles into the spatial hash:
+    // per-thread histograms over static particle blocks, a prefix sum over cells,
+    // then a scatter with each thread starting at its own per-cell offset. Thread
+    // blocks are contiguous and ascending, so ids inside a cell stay in particle
+    // order and the result matches a serial build for any thread count.
+    static void buildParticleGrid_native(SimContext* ctx) {
+        const int numParticles = ctx->numParticles;
+        const int pNumX = ctx->pNumX;
+        const int pNumY = ctx->pNumY;
+        const int pNumCells = ctx->pNumCells;
+        const float pInvSpacing = ctx->pInvSpacing;
+        const float* particleX = ctx->particleX.data();
+        const float* particleY = ctx->particleY.data();
+        int32_t* numCellParticles = ctx->numCellParticles.data();
+        int32_t* firstCellParticle = ctx->firstCellParticle.data();
+        int32_t* cellParticleIds = ctx->cellParticleIds.data();
+
+        const int maxThreads = omp_get_max_threads();
+        if (ctx->threadCellCounts.size() < static_cast<size_t>(maxThreads) * pNumCells) {
+            ctx->threadCellCounts.resize(static_cast<size_t>(maxThreads) * pNumCells);
+        }
+        if (ctx->particleCell.size() < static_cast<size_t>(ctx->maxParticles)) {
+            ctx->particleCell.resize(ctx->maxParticles);
+        }
+        int32_t* particleCell = ctx->particleCell.data();
+        int32_t* threadCounts = ctx->threadCellCounts.data();
+        int usedThreads = 1;
+
+        #pragma omp parallel
+        {
+            const int t = omp_get_thread_num();
+            #pragma omp single
+            usedThreads = omp_get_num_threads();
+            int32_t* counts = threadCounts + static_cast<size_t>(t) * pNumCells;
+            std::fill(counts, counts + pNumCells, 0);
+
+            // 1. Histogram (same static particle split as the scatter below)
+            #pragma omp for schedule(static)
+            for (int i = 0; i < numParticles; ++i) {
+                const int xi = static_cast<int>(clamp_cpp(floorf(particleX[i] * pInvSpacing), 0.0f, static_cast<float>(pNumX - 1)));
+                const int yi = static_cast<int>(clamp_cpp(floorf(particleY[i] * pInvSpacing), 0.0f, static_cast<float>(pNumY - 1)));
+                const int cell = xi * pNumY + yi;
+                particleCell[i] = cell;
+                counts[cell]++;
+            }
+
+            // 2. Per-cell totals
+            #pragma omp for schedule(static)
+            for (int c = 0; c < pNumCells; ++c) {
+                int total = 0;
+                for (int k = 0; k < usedThreads; ++k) total += threadCounts[static_cast<size_t>(k) * pNumCells + c];
+                numCellParticles[c] = total;
+            }
+
+            // 3. Exclusive prefix sum over cells (small, serial)
+            #pragma omp single
+            {
+                int sum = 0;
+                for (int c = 0; c < pNumCells; ++c) {
+                    firstCellParticle[c] = sum;
+                    sum += numCellParticles[c];
+                }
+                firstCellParticle[pNumCells] = sum;
+            }
+
+            // 4. Turn the histograms into per-thread scatter cursors
+            #pragma omp for schedule(static)
+            for (int c = 0; c < pNumCells; ++c) {
+                int cursor = firstCellParticle[c];
+                for (int k = 0; k < usedThreads; ++k) {
+                    int32_t& slot = threadCounts[static_cast<size_t>(k) * pNumCells + c];
+                    const int count = slot;
+                    slot = cursor;
+                    cursor += count;
+                }
+            }
+
+            // 5. Scatter
+            #pragma omp for schedule(static)
+            for (int i = 0; i < numParticles; ++i) {
+                cellParticleIds[counts[particleCell[i]]++] = i;
+            }
+        }
+    }
+
+    // Sorts every per-particle array into spatial-hash cell order (cells are
+    // column-major like the MAC grid, so index order now walks the grid column by
+    // column). Needs a fresh buildParticleGrid_native; leaves the hash valid by
+    // rewriting cellParticleIds to the identity.
+    // This is the single permutation hook: any new per-particle attribute must be
+    // gathered here, and particlePermutation (new -> old) lets callers follow along.
+    static void reorderParticles_native(SimContext* ctx) {
+        const int numParticles = ctx->numParticles;
+        int32_t* perm = ctx->particlePermutation.data();
+        int32_t* cellParticleIds = ctx->cellParticleIds.data();
+        if (ctx->reorderScratch.size() < static_cast<size_t>(ctx->maxParticles)) {
+            ctx->reorderScratch.resize(ctx->maxParticles);
+        }
+        if (ctx->reorderGradeScratch.size() < static_cast<size_t>(ctx->maxParticles)) {
+            ctx->reorderGradeScratch.resize(ctx->maxParticles);
+        }
+
+        auto permute = [&](auto* attr, auto* tmp) {
+            #pragma omp parallel for schedule(static)
+            for (int k = 0; k < numParticles; ++k) tmp[k] = attr[perm[k]];
+            // Copy back so the Dart views onto these buffers stay valid
+            std::copy(tmp, tmp + numParticles, attr);
+        };
+
+        std::copy(cellParticleIds, cellParticleIds + numParticles, perm);
+        float* tmp = ctx->reorderScratch.data();
+        permute(ctx->particleX.data(), tmp);
+        permute(ctx->particleY.data(), tmp);
+        permute(ctx->particleVelX.data(), tmp);
+        permute(ctx->particleVelY.data(), tmp);
+        permute(ctx->particleGrade.data(), ctx->reorderGradeScratch.data());
 
         #pragma omp parallel for schedule(static)
-        for (int i = 0; i < numParticles; i++) {
-            const int pIdx = 2 * i;
-            float px = particlePos_param[pIdx];
-            float py = particlePos_param[pIdx + 1];
-            float pvx = particleVel_param[pIdx];
-            float pvy = particleVel_param[pIdx + 1];
-
-            if (isObstacleActive_param) {
-                const float dxObs = px - obstacleX_param;
-                const float dyObs = py - obstacleY_param;
-                const float d2Obs = dxObs * dxObs + dyObs * dyObs;
-                if (d2Obs < obsInteractRadiusSq && d2Obs > 1e-12f) {
-                    const float dObs = sqrtf(d2Obs);
-                    const float overlapObs = obsInteractRadius - dObs;
-                    const float pushFactor = 1.0f; // Match Dart
-                    px += (dxObs / dObs) * overlapObs * pushFactor;
-                    py += (dyObs / dObs) * overlapObs * pushFactor;
-                    pvx = obstacleVelX_param;
-                    pvy = obstacleVelY_param;
-                }
-            }
-
-            const float dxWall = px - sceneCircleCenterX_param;
-            const float dyWall = py - sceneCircleCenterY_param;
-            const float distSqToWallCenter = dxWall * dxWall + dyWall * dyWall;
-            if (distSqToWallCenter > wallCollisionRadius * wallCollisionRadius && distSqToWallCenter > 1e-12f) {
-                const float distToWallCenter = sqrtf(distSqToWallCenter);
-                const float overlapWall = distToWallCenter - wallCollisionRadius;
-                px -= (dxWall / distToWallCenter) * overlapWall;
-                py -= (dyWall / distToWallCenter) * overlapWall;
-                pvx = 0.0f;
-                pvy = 0.0f;
-            }
-            particlePos_param[pIdx] = px;
-            particlePos_param[pIdx + 1] = py;
-            particleVel_param[pIdx] = pvx;
-            particleVel_param[pIdx + 1] = pvy;
+        for (int k = 0; k < numParticles; ++k) cellParticleIds[k] = k;
+    }
+
+    // Interleaved API view <-> SoA kernel store, for the first `count` particles
+    static void importInterleavedParticles_native(SimContext* ctx, int count) {
+        const float* pos = ctx->particlePos.data();
+        const float* vel = ctx->particleVel.data();
+        float* x = ctx->particleX.data();
+        float* y = ctx->particleY.data();
+        float* vx = ctx->particleVelX.data();
+        float* vy = ctx->particleVelY.data();
+        const int numGroups = count / 4;
+        #pragma omp parallel for schedule(static)
+        for (int g = 0; g < numGroups; ++g) {
+            const int i = 4 * g;
+            simd::float4 px, py, wx, wy;
+            simd::loadInterleaved(&pos[2 * i], px, py);
+            simd::loadInterleaved(&vel[2 * i], wx, wy);
+            simd::store(&x[i], px); simd::store(&y[i], py);
+            simd::store(&vx[i], wx); simd::store(&vy[i], wy);
         }
-    } // End handleCollisions_native
+        for (int i = 4 * numGroups; i < count; ++i) {
+            x[i] = pos[2 * i]; y[i] = pos[2 * i + 1];
+            vx[i] = vel[2 * i]; vy[i] = vel[2 * i + 1];
+        }
+    }
+
+    static void exportInterleavedParticles_native(SimContext* ctx, int count) {
+        float* pos = ctx->particlePos.data();
+        float* vel = ctx->particleVel.data();
+        const float* x = ctx->particleX.data();
+        const float* y = ctx->particleY.data();
+        const float* vx = ctx->particleVelX.data();
+        const float* vy = ctx->particleVelY.data();
+        const int numGroups = count / 4;
+        #pragma omp parallel for schedule(static)
+        for (int g = 0; g < numGroups; ++g) {
+            const int i = 4 * g;
+            simd::storeInterleaved(&pos[2 * i], simd::load(&x[i]), simd::load(&y[i]));
+            simd::storeInterleaved(&vel[2 * i], simd::load(&vx[i]), simd::load(&vy[i]));
+        }
+        for (int i = 4 * numGroups; i < count; ++i) {
+            pos[2 * i] = x[i]; pos[2 * i + 1] = y[i];
+            vel[2 * i] = vx[i]; vel[2 * i + 1] = vy[i];
+        }
+    }
+
+    // Largest particle speed and grid face velocity of the current state, the
+    // velocity bound used to pick CFL-limited substeps
+    static float maxVelocity_native(SimContext* ctx, int numParticles) {
+        const float* vx = ctx->particleVelX.data();
+        const float* vy = ctx->particleVelY.data();
+        const float* u = ctx->u.data();
+        const float* v = ctx->v.data();
+        const int numGroups = numParticles / 4;
+        const int gridPadded = static_cast<int>(ctx->u.padded);
+        float maxSpeed2 = 0.0f, maxFace = 0.0f;
+        #pragma omp parallel
+        {
+            simd::float4 speed2_vec = simd::splat(0.0f);
+            simd::float8 face_vec = simd::splat8(0.0f);
+            #pragma omp for schedule(static) nowait
+            for (int g = 0; g < numGroups; ++g) {
+                const simd::float4 wx = simd::load(&vx[4 * g]);
+                const simd::float4 wy = simd::load(&vy[4 * g]);
+                speed2_vec = simd::max(speed2_vec, simd::madd(simd::mul(wx, wx), wy, wy));
+            }
+            // Grid fields are padded with zeros, so whole vectors cover them
+            #pragma omp for schedule(static)
+            for (int k = 0; k < gridPadded; k += 8) {
+                face_vec = simd::max(face_vec, simd::max(simd::abs(simd::load8(&u[k])), simd::abs(simd::load8(&v[k]))));
+            }
+            const float localSpeed2 = simd::hmax(speed2_vec);
+            const float localFace = simd::hmax(face_vec);
+            #pragma omp critical
+            {
+                maxSpeed2 = fmaxf(maxSpeed2, localSpeed2);
+                maxFace = fmaxf(maxFace, localFace);
+            }
+        }
+        for (int i = 4 * numGroups; i < numParticles; ++i) { // Scalar remainder
+            maxSpeed2 = fmaxf(maxSpeed2, vx[i] * vx[i] + vy[i] * vy[i]);
+        }
+        return fmaxf(sqrtf(maxSpeed2), maxFace);
+    }
+
+#ifdef __linux__
+    // CPU set for the worker pool: the `budget` fastest (BIG) or slowest (LITTLE)
+    // cores by cpuinfo_max_freq, or every core for ANY. Returns false when the
+    // core speeds cannot be read, in which case placement is left to the OS.
+    static bool selectWorkerCpus_native(int affinity, int budget, cpu_set_t* mask) {
+        const int numCpus = std::min(static_cast<int>(sysconf(_SC_NPROCESSORS_CONF)), static_cast<int>(CPU_SETSIZE));
+        CPU_ZERO(mask);
+        if (affinity == THREAD_AFFINITY_ANY) {
+            for (int cpu = 0; cpu < numCpus; ++cpu) CPU_SET(cpu, mask);
+            return numCpus > 0;
+        }
+        std::vector<std::pair<long, int>> cores; // (max kHz, cpu)
+        for (int cpu = 0; cpu < numCpus; ++cpu) {
+            char path[96];
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+            FILE* f = fopen(path, "r");
+            if (f == nullptr) continue;
+            long khz = 0;
+            if (fscanf(f, "%ld", &khz) == 1 && khz > 0) cores.emplace_back(khz, cpu);
+            fclose(f);
+        }
+        if (cores.empty()) return false;
+        const bool fastest = affinity == THREAD_AFFINITY_BIG;
+        std::stable_sort(cores.begin(), cores.end(), [fastest](const std::pair<long, int>& a, const std::pair<long, int>& b) {
+            return fastest ? a.first > b.first : a.first < b.first;
+        });
+        const int count = std::max(1, std::min(budget, static_cast<int>(cores.size())));
+        for (int k = 0; k < count; ++k) CPU_SET(cores[k].second, mask);
+        return true;
+    }
+#endif
+
+    // Marks the native simulation thread, whose own placement follows the pool's.
+    static thread_local bool isSimThread = false;
+
+    // Sizes and places the OpenMP team of the calling thread per the context's
+    // thread config. Runs at the start of every frame and before the other
+    // parallel kernels, and only does work after the config changed or when a
+    // different thread / context starts stepping. The caller holds stepMutex.
+    static void applyThreadConfig_native(SimContext* ctx) {
+        static thread_local uint64_t appliedSerial = 0;
+        if (appliedSerial == ctx->threadConfigSerial) return;
+        appliedSerial = ctx->threadConfigSerial;
+
+        const int requested = ctx->governor.enabled ? ctx->governor.threads : ctx->threadBudget;
+        const int budget = requested > 0 ? requested : omp_get_num_procs();
+        omp_set_num_threads(budget);
+#ifdef KMP_VERSION_MAJOR // LLVM libomp (Android NDK): workers spin this long before parking
+        if (ctx->threadSpinMillis >= 0) kmp_set_blocktime(ctx->threadSpinMillis);
+#endif
+#ifdef __linux__
+        cpu_set_t mask;
+        if (selectWorkerCpus_native(ctx->threadAffinity, budget, &mask)) {
+            // Only pin the caller if it is our own thread, never the UI thread
+            const bool pinCaller = isSimThread;
+            #pragma omp parallel
+            {
+                if (omp_get_thread_num() != 0 || pinCaller) sched_setaffinity(0, sizeof(mask), &mask);
+            }
+        }
+#endif
+    }
+
+    // Restores the container mask in s and, when active, carves the obstacle
+    // disc out of it and imposes its velocity on the faces of the covered cells
+    // (ported from Dart setObstacle).
+    static void applyObstacle_native(SimContext* ctx, const GridEdit& edit) {
+        const int fNumX = ctx->fNumX, n = ctx->fNumY;
+        const double h = ctx->h;
+        const double mainRSq = (double)ctx->circleRadius * ctx->circleRadius;
+        const double dragRSq = (double)edit.obstacleRadius * edit.obstacleRadius;
+        float* s = ctx->s.data();
+        float* u = ctx->u.data();
+        float* v = ctx->v.data();
+        for (int i = 0; i < fNumX; ++i) {
+            for (int j = 0; j < n; ++j) {
+                const int idx = i * n + j;
+                const double cellX = (i + 0.5) * h, cellY = (j + 0.5) * h;
+                const double dxMain = cellX - ctx->circleCenterX, dyMain = cellY - ctx->circleCenterY;
+                if (dxMain * dxMain + dyMain * dyMain > mainRSq) {
+                    s[idx] = 0.0f;
+                    continue;
+                }
+                s[idx] = 1.0f;
+                if (!edit.isObstacleActive) continue;
+                const double dxDrag = cellX - edit.obstacleX, dyDrag = cellY - edit.obstacleY;
+                if (dxDrag * dxDrag + dyDrag * dyDrag < dragRSq) {
+                    s[idx] = 0.0f;
+                    u[idx] = edit.obstacleVelX;
+                    if (i + 1 < fNumX) u[idx + n] = edit.obstacleVelX;
+                    v[idx] = edit.obstacleVelY;
+                    if (j + 1 < n) v[idx + 1] = edit.obstacleVelY;
+                }
+            }
+        }
+    }
+
+    // Resets s to the container mask and clears every grid velocity and the
+    // pressure (ported from Dart initializeGrid).
+    static void resetGrid_native(SimContext* ctx) {
+        const int n = ctx->fNumY;
+        const double h = ctx->h;
+        const double rSq = (double)ctx->circleRadius * ctx->circleRadius;
+        for (int i = 0; i < ctx->fNumX; ++i) {
+            for (int j = 0; j < n; ++j) {
+                const double dx = (i + 0.5) * h - ctx->circleCenterX, dy = (j + 0.5) * h - ctx->circleCenterY;
+                ctx->s[i * n + j] = (dx * dx + dy * dy > rSq) ? 0.0f : 1.0f;
+            }
+        }
+        for (ArenaField<float>* field : { &ctx->u, &ctx->v, &ctx->du, &ctx->dv, &ctx->prevU, &ctx->prevV, &ctx->p }) {
+            std::fill(field->begin(), field->end(), 0.0f);
+        }
+    }
+
+    // Applies and clears queued grid edits in submission order. The caller holds stepMutex.
+    static void applyGridEdits_native(SimContext* ctx, std::vector<GridEdit>& edits) {
+        for (const GridEdit& edit : edits) {
+            if (edit.resetGrid) resetGrid_native(ctx); else applyObstacle_native(ctx, edit);
+        }
+        edits.clear();
+    }
+
+    // Joins the simulation thread and applies edits it had not picked up yet.
+    static void stopSimThread_native(SimContext* ctx) {
+        if (!ctx->simThreadRunning.exchange(false, std::memory_order_acq_rel)) return;
+        if (ctx->simThread.joinable()) ctx->simThread.join();
+        std::vector<GridEdit> edits;
+        {
+            std::lock_guard<std::mutex> lock(ctx->paramsMutex);
+            edits.swap(ctx->pendingGridEdits);
+        }
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        applyGridEdits_native(ctx, edits);
+    }
+
+    // Returns nullptr if allocation fails.
+    SimContext* sim_create(
+        int fNumX, int fNumY, float h, float density,
+        int maxParticles, float particleRadius,
+        int pNumX, int pNumY, float pInvSpacing,
+        float circleCenterX, float circleCenterY, float circleRadius,
+        bool enableDynamicColoring
+    ) {
+        SimContext* ctx = nullptr;
+        try {
+            ctx = new SimContext();
+            ctx->fNumX = fNumX;
+            ctx->fNumY = fNumY;
+            ctx->fNumCells = fNumX * fNumY;
+            ctx->h = h;
+            ctx->invH = 1.0f / h;
+            ctx->density = density;
+            ctx->maxParticles = maxParticles;
+            ctx->particleRadius = particleRadius;
+            ctx->pNumX = pNumX;
+            ctx->pNumY = pNumY;
+            ctx->pNumCells = pNumX * pNumY;
+            ctx->pInvSpacing = pInvSpacing;
+            ctx->circleCenterX = circleCenterX;
+            ctx->circleCenterY = circleCenterY;
+            ctx->circleRadius = circleRadius;
+            ctx->enableDynamicColoring = enableDynamicColoring;
+
+            // Carve every field out of one aligned arena: a sizing pass (base == nullptr)
+            // followed by a binding pass over the zeroed block
+            const size_t fNumCells = static_cast<size_t>(ctx->fNumCells);
+            const size_t particles = static_cast<size_t>(maxParticles);
+            auto layoutFields = [&](char* base) {
+                size_t offset = 0;
+                auto place = [&](auto& field, size_t count, size_t ghost) {
+                    using T = std::remove_reference_t<decltype(*field.ptr)>;
+                    const size_t ghostBytes = (ghost * sizeof(T) + SIMD_ALIGNMENT - 1) / SIMD_ALIGNMENT * SIMD_ALIGNMENT;
+                    const size_t bodyBytes = (count * sizeof(T) + SIMD_ALIGNMENT - 1) / SIMD_ALIGNMENT * SIMD_ALIGNMENT;
+                    if (base != nullptr) {
+                        field.ptr = reinterpret_cast<T*>(base + offset + ghostBytes);
+                        field.count = count;
+                        field.padded = bodyBytes / sizeof(T);
+                        field.ghost = ghostBytes / sizeof(T);
+                    }
+                    offset += ghostBytes + bodyBytes + ghostBytes;
+                };
+                const size_t gridGhost = static_cast<size_t>(fNumY);
+                for (ArenaField<float>* field : { &ctx->u, &ctx->v, &ctx->du, &ctx->dv, &ctx->prevU, &ctx->prevV,
+                                                  &ctx->p, &ctx->s, &ctx->particleDensity }) {
+                    place(*field, fNumCells, gridGhost);
+                }
+                place(ctx->cellType, fNumCells, gridGhost);
+                for (ArenaField<float>* attr : { &ctx->particleX, &ctx->particleY, &ctx->particleVelX, &ctx->particleVelY }) {
+                    place(*attr, particles, 0);
+                }
+                place(ctx->particlePos, 2 * particles, 0);
+                place(ctx->particleVel, 2 * particles, 0);
+                place(ctx->particleGrade, particles, 0); // Deep blue
+                return offset;
+            };
+            ctx->arena.bytes = layoutFields(nullptr);
+            if (posix_memalign(&ctx->arena.block, SIMD_ALIGNMENT, ctx->arena.bytes) != 0) {
+                ctx->arena.block = nullptr;
+                throw std::bad_alloc();
+            }
+            memset(ctx->arena.block, 0, ctx->arena.bytes);
+            layoutFields(static_cast<char*>(ctx->arena.block));
+            // Cell types, including ghosts and padding, start as AIR
+            std::fill(ctx->cellType.ptr - ctx->cellType.ghost,
+                      ctx->cellType.ptr + ctx->cellType.padded + ctx->cellType.ghost, AIR_CELL_CPP);
+
+            bumpThreadConfig_native(ctx);
+            applyThreadConfig_native(ctx);
+            buildStaticBoundaryMasks_native(fNumX, fNumY, h, circleCenterX, circleCenterY, circleRadius,
+                                            &ctx->boundaryMasks);
+
+            ctx->numCellParticles.assign(ctx->pNumCells, 0);
+            ctx->firstCellParticle.assign(ctx->pNumCells + 1, 0);
+            ctx->cellParticleIds.assign(maxParticles, 0);
+            ctx->separationScratch.x.assign(maxParticles, 0.0f);
+            ctx->separationScratch.y.assign(maxParticles, 0.0f);
+            ctx->separationScratch.dx.assign(maxParticles, 0.0f);
+            ctx->separationScratch.dy.assign(maxParticles, 0.0f);
+            ctx->separationScratch.g.assign(maxParticles, 0.0f);
+            ctx->separationScratch.dg.assign(maxParticles, 0.0f);
+            ctx->particlePermutation.resize(maxParticles);
+            for (int i = 0; i < maxParticles; ++i) ctx->particlePermutation[i] = i;
+            ctx->stageTimings.assign(SIM_STAGE_COUNT, 0.0f);
+        } catch (...) {
+            delete ctx;
+            return nullptr;
+        }
+        return ctx;
+    }
+
+    void sim_destroy(SimContext* ctx) {
+        if (ctx == nullptr) return;
+        stopSimThread_native(ctx);
+        delete ctx;
+    }
+
+    // Zero-copy access to a context-owned field; see SimBufferId.
+    void* sim_get_buffer(SimContext* ctx, int32_t bufferId) {
+        if (ctx == nullptr) return nullptr;
+        switch (bufferId) {
+            case SIM_BUFFER_U: return ctx->u.data();
+            case SIM_BUFFER_V: return ctx->v.data();
+            case SIM_BUFFER_DU: return ctx->du.data();
+            case SIM_BUFFER_DV: return ctx->dv.data();
+            case SIM_BUFFER_PREV_U: return ctx->prevU.data();
+            case SIM_BUFFER_PREV_V: return ctx->prevV.data();
+            case SIM_BUFFER_P: return ctx->p.data();
+            case SIM_BUFFER_S: return ctx->s.data();
+            case SIM_BUFFER_CELL_TYPE: return ctx->cellType.data();
+            case SIM_BUFFER_PARTICLE_DENSITY: return ctx->particleDensity.data();
+            case SIM_BUFFER_PARTICLE_POS: return ctx->particlePos.data();
+            case SIM_BUFFER_PARTICLE_VEL: return ctx->particleVel.data();
+            case SIM_BUFFER_PARTICLE_GRADE: return ctx->particleGrade.data();
+            case SIM_BUFFER_STAGE_TIMINGS: return ctx->stageTimings.data();
+            case SIM_BUFFER_PARTICLE_PERMUTATION: return ctx->particlePermutation.data();
+            case SIM_BUFFER_PARTICLE_X: return ctx->particleX.data();
+            case SIM_BUFFER_PARTICLE_Y: return ctx->particleY.data();
+            case SIM_BUFFER_PARTICLE_VEL_X: return ctx->particleVelX.data();
+            case SIM_BUFFER_PARTICLE_VEL_Y: return ctx->particleVelY.data();
+            case SIM_BUFFER_GOVERNOR_STATE: return ctx->governor.state;
+            default: return nullptr;
+        }
+    }
+
+    float sim_get_particle_rest_density(SimContext* ctx) {
+        return ctx != nullptr ? ctx->particleRestDensity : 0.0f;
+    }
+
+    // Selects the pressure solver used by sim_step (PRESSURE_SOLVER_*).
+    void sim_set_pressure_solver(SimContext* ctx, int32_t pressureSolver) {
+        if (ctx == nullptr) return;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        ctx->pressureSolver = pressureSolver;
+    }
+
+    // Max-norm divergence at which the pressure solve stops early, checked every
+    // checkInterval sweeps. tolerance <= 0 restores the fixed iteration count.
+    void sim_set_pressure_tolerance(SimContext* ctx, float tolerance, int32_t checkInterval) {
+        if (ctx == nullptr) return;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        ctx->pressureTolerance = tolerance;
+        ctx->pressureCheckInterval = std::max(1, (int)checkInterval);
+    }
+
+    // Reuses the previous frame's pressure as the initial guess instead of zeroing it.
+    void sim_set_pressure_warm_start(SimContext* ctx, bool warmStart) {
+        if (ctx == nullptr) return;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        ctx->pressureWarmStart = warmStart;
+    }
+
+    // Worker pool settings: threadBudget workers (<= 0: one per processor), placed
+    // per THREAD_AFFINITY_*, spinning spinMillis before parking when idle (< 0
+    // keeps the runtime default; LLVM libomp only). Takes effect with the next frame.
+    void sim_set_thread_config(SimContext* ctx, int32_t threadBudget, int32_t affinity, int32_t spinMillis) {
+        if (ctx == nullptr) return;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        ctx->threadBudget = threadBudget;
+        ctx->threadAffinity = affinity;
+        ctx->threadSpinMillis = spinMillis;
+        bumpThreadConfig_native(ctx);
+    }
+
+    // Configures the frame-budget quality governor used by sim_step_frame (and the
+    // simulation thread). The frame params passed per frame are the upper bounds;
+    // iterations never drop below the given minima, workers stay within
+    // [minThreads, maxThreads], and separation / dynamic coloring are only switched
+    // off when allowed. Above throttleTemperature (see sim_set_governor_temperature)
+    // the budget tightens. Enabling starts from full quality.
+    void sim_set_governor(SimContext* ctx, bool enabled, float targetFrameMs,
+                          int32_t minPressureIters, int32_t minParticleIters,
+                          int32_t minThreads, int32_t maxThreads,
+                          bool mayDropSeparation, bool mayDropColoring,
+                          float throttleTemperature) {
+        if (ctx == nullptr) return;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        QualityGovernor& g = ctx->governor;
+        g.targetFrameMs = std::max(0.1f, targetFrameMs);
+        g.minPressureIters = std::max(1, (int)minPressureIters);
+        g.minParticleIters = std::max(0, (int)minParticleIters);
+        g.minThreads = std::max(1, (int)minThreads);
+        g.maxThreads = std::max(g.minThreads, (int)maxThreads);
+        g.mayDropSeparation = mayDropSeparation;
+        g.mayDropColoring = mayDropColoring;
+        g.throttleTemperature = throttleTemperature;
+        if (enabled && !g.enabled) {
+            const int configured = ctx->threadBudget > 0 ? ctx->threadBudget : omp_get_num_procs();
+            g.pressureIters = g.particleIters = -1;
+            g.separation = g.coloring = true;
+            g.threads = configured;
+            g.smoothedMs = 0.0f;
+            g.overFrames = g.underFrames = g.cooldown = 0;
+        }
+        g.threads = std::max(g.minThreads, std::min(g.maxThreads, g.threads));
+        if (enabled != g.enabled) std::fill(g.state, g.state + GOVERNOR_STATE_COUNT, 0.0f);
+        g.enabled = enabled;
+        bumpThreadConfig_native(ctx);
+    }
+
+    // Latest device temperature in degrees C for the governor (below -900: unknown).
+    void sim_set_governor_temperature(SimContext* ctx, float celsius) {
+        if (ctx == nullptr) return;
+        ctx->governor.temperature.store(celsius, std::memory_order_relaxed);
+    }
+
+    // Selects the particle separation scheme used by sim_step (SEPARATION_*).
+    void sim_set_separation_mode(SimContext* ctx, int32_t mode) {
+        if (ctx == nullptr) return;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        ctx->separationMode = mode;
+    }
+
+    // Selects which particle buffers the caller reads and writes (PARTICLE_LAYOUT_*).
+    // Switching carries the current particles over to the newly exposed buffers.
+    void sim_set_particle_layout(SimContext* ctx, int32_t layout) {
+        if (ctx == nullptr) return;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        if (layout == ctx->particleLayout) return;
+        applyThreadConfig_native(ctx);
+        if (layout == PARTICLE_LAYOUT_SOA) {
+            importInterleavedParticles_native(ctx, ctx->maxParticles);
+        } else {
+            exportInterleavedParticles_native(ctx, ctx->maxParticles);
+        }
+        ctx->particleLayout = layout;
+    }
+
+    // Sorts the particle arrays by spatial-hash cell every `interval` frames (0 disables).
+    void sim_set_reorder_interval(SimContext* ctx, int32_t interval) {
+        if (ctx == nullptr) return;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        ctx->reorderInterval = std::max(0, (int)interval);
+    }
+
+    // Iterations used by the most recent pressure solve.
+    int32_t sim_get_pressure_iterations(SimContext* ctx) {
+        return ctx != nullptr ? ctx->pressureWs.lastIterations : 0;
+    }
+
+    // Max-norm divergence residual of the most recent pressure solve (-1 if not measured).
+    float sim_get_pressure_residual(SimContext* ctx) {
+        return ctx != nullptr ? ctx->pressureWs.lastResidual : -1.0f;
+    }
+
+    // Fills the bottom of the container with a hex lattice of up to targetCount
+    // particles (spacing 2r, odd rows offset by r, points inside the circle shrunk
+    // by r) and returns how many were written. Mirrors the old Dart fillCircleBottom:
+    // the water line is the first multiple of r (at most 100 steps or the full
+    // diameter) whose rows hold targetCount points. One lattice walk gives per-row
+    // counts; the water line is then a bisection over their prefix sums.
+    // Particles go straight into the native buffers with zero velocity and grade.
+    int32_t sim_seed_particles(SimContext* ctx, int32_t targetCount) {
+        if (ctx == nullptr) return 0;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        const int target = std::max(0, std::min((int)targetCount, ctx->maxParticles));
+        const double r = ctx->particleRadius;
+        const double dx = 2.0 * r;
+        const double dy = std::sqrt(3.0) / 2.0 * dx;
+        ctx->numParticles = 0;
+        ctx->seedFillHeight = 0.0f;
+        if (target == 0 || dx <= 0.0) return 0;
+
+        const double cx = ctx->circleCenterX, cy = ctx->circleCenterY, R = ctx->circleRadius;
+        const double insideRadiusSq = (R - r) * (R - r);
+        const double startX = cx - R;
+        const double startY = cy - R;
+        const int numRows = static_cast<int>(std::ceil(2.0 * R / dy)) + 2;
+        const int numCols = static_cast<int>(std::ceil(2.0 * R / dx)) + 2;
+
+        // Calls fn(x, y) for every lattice point of row j inside the container
+        auto forEachInRow = [&](int j, auto&& fn) {
+            const double yj = startY + j * dy;
+            for (int i = 0; i < numCols; ++i) {
+                const double xi = startX + i * dx + ((j & 1) ? r : 0.0);
+                if (xi - r > cx + R && i > 0) break;
+                if (xi + r < cx - R) continue;
+                const double ex = xi - cx, ey = yj - cy;
+                if (ex * ex + ey * ey < insideRadiusSq) fn(xi, yj);
+            }
+        };
+
+        // Per-row counts and their prefix sums (rows are in ascending y)
+        std::vector<int> rowPrefix(numRows + 1, 0);
+        int usedRows = 0;
+        for (int j = 0; j < numRows; ++j) {
+            const double yj = startY + j * dy;
+            if (yj - r > cy + R && j > 0) break;
+            int count = 0;
+            forEachInRow(j, [&](double, double) { ++count; });
+            rowPrefix[j + 1] = rowPrefix[j] + count;
+            usedRows = j + 1;
+        }
+        // Points strictly below height (from the container bottom)
+        auto countBelow = [&](double height) {
+            const double lineY = startY + height;
+            int rows = 0;
+            while (rows < usedRows && startY + rows * dy < lineY) ++rows; // usedRows is small
+            return rowPrefix[rows];
+        };
+
+        // Smallest step k (height k * r) that reaches the target or the diameter
+        const int maxSteps = 101; // 100 checked steps, the next height is taken as is
+        int lo = 1, hi = maxSteps;
+        while (lo < hi) {
+            const int mid = (lo + hi) / 2;
+            if (countBelow(mid * r) >= target || mid * r >= 2.0 * R) hi = mid; else lo = mid + 1;
+        }
+        const double fillHeight = lo * r;
+        ctx->seedFillHeight = static_cast<float>(fillHeight);
+
+        // Write the lattice row by row up to the water line / target
+        const double lineY = startY + fillHeight;
+        float* px = ctx->particleX.data();
+        float* py = ctx->particleY.data();
+        int n = 0;
+        for (int j = 0; j < usedRows && n < target; ++j) {
+            if (!(startY + j * dy < lineY)) break;
+            forEachInRow(j, [&](double x, double y) {
+                if (n >= target) return;
+                px[n] = static_cast<float>(x);
+                py[n] = static_cast<float>(y);
+                ++n;
+            });
+        }
+        std::fill(ctx->particleVelX.begin(), ctx->particleVelX.begin() + n, 0.0f);
+        std::fill(ctx->particleVelY.begin(), ctx->particleVelY.begin() + n, 0.0f);
+        std::fill(ctx->particleGrade.begin(), ctx->particleGrade.begin() + n, 0);
+        if (ctx->particleLayout == PARTICLE_LAYOUT_INTERLEAVED) {
+            applyThreadConfig_native(ctx);
+            exportInterleavedParticles_native(ctx, n);
+        }
+        ctx->numParticles = n;
+        return n;
+    }
+
+    // Water line height used by the most recent sim_seed_particles.
+    float sim_get_seed_fill_height(SimContext* ctx) {
+        return ctx != nullptr ? ctx->seedFillHeight : 0.0f;
+    }
+
+    // One FLIP substep (integrate -> separate -> collide -> P2G -> density -> pressure
+    // -> G2P) on the SoA particle store. Stage times are added to ctx->stageTimings,
+    // so a multi-substep frame reports per-frame totals.
+    static void simulateSubstep_native(
+        SimContext* ctx, int nP,
+        float dt, float gravityX, float gravityY, float flipRatio,
+        int numPressureIters, int numParticleIters, float overRelaxation,
+        bool compensateDrift, bool separateParticles, bool dynamicColoring, bool reorder,
+        bool isObstacleActive, float obstacleX, float obstacleY, float obstacleRadius,
+        float obstacleVelX, float obstacleVelY
+    ) {
+        float* particleX = ctx->particleX.data();
+        float* particleY = ctx->particleY.data();
+        float* particleVelX = ctx->particleVelX.data();
+        float* particleVelY = ctx->particleVelY.data();
+
+        float* timings = ctx->stageTimings.data();
+        double lapStart = omp_get_wtime();
+        auto lap = [&](int stage) {
+            const double now = omp_get_wtime();
+            timings[stage] += static_cast<float>((now - lapStart) * 1000.0);
+            lapStart = now;
+        };
+
+        // 1. Integrate particles. Without separation nothing runs between integration
+        //    and collisions, so both happen in one fused sweep (step 3 is skipped).
+        const bool fuseCollisions = !separateParticles;
+        advanceParticles_native(
+            particleX, particleY, particleVelX, particleVelY, nP,
+            true, dt, gravityX, gravityY,
+            fuseCollisions, ctx->particleRadius,
+            isObstacleActive, obstacleX, obstacleY, obstacleRadius, obstacleVelX, obstacleVelY,
+            ctx->circleCenterX, ctx->circleCenterY, ctx->circleRadius);
+        lap(SIM_STAGE_INTEGRATE);
+
+        // 2. Particle separation (+ optional color diffusion and periodic spatial reorder)
+        if (separateParticles || reorder) {
+            buildParticleGrid_native(ctx);
+            lap(SIM_STAGE_PARTICLE_GRID);
+        }
+        if (reorder) {
+            reorderParticles_native(ctx);
+            lap(SIM_STAGE_REORDER);
+        }
+        if (separateParticles) {
+            const float minDist = 2.0f * ctx->particleRadius;
+            const float colorDiffusionCoefficient = 0.001f;
+            // The last separation iteration also diffuses colors, sharing its neighbour walk
+            const bool fuseColors = dynamicColoring && numParticleIters > 0;
+            uint16_t* fusedGrade = fuseColors ? ctx->particleGrade.data() : nullptr;
+            if (ctx->separationMode == SEPARATION_COLORED) {
+                pushParticlesApartColored_native(
+                    particleX, particleY, ctx->firstCellParticle.data(), ctx->cellParticleIds.data(),
+                    ctx->pNumX, ctx->pNumY, numParticleIters,
+                    ctx->particleRadius, minDist * minDist, fusedGrade, colorDiffusionCoefficient);
+            } else if (ctx->separationMode == SEPARATION_JACOBI) {
+                pushParticlesApartJacobi_native(
+                    particleX, particleY, &ctx->separationScratch,
+                    ctx->firstCellParticle.data(), ctx->cellParticleIds.data(),
+                    nP, ctx->pNumX, ctx->pNumY, numParticleIters,
+                    ctx->particleRadius, minDist * minDist, fusedGrade, colorDiffusionCoefficient);
+            } else {
+                pushParticlesApart_native(
+                    particleX, particleY, ctx->firstCellParticle.data(), ctx->cellParticleIds.data(),
+                    nP, ctx->pNumX, ctx->pNumY, ctx->pInvSpacing, numParticleIters,
+                    ctx->particleRadius, minDist * minDist, fusedGrade, colorDiffusionCoefficient);
+            }
+            lap(SIM_STAGE_PUSH_APART);
+
+            if (dynamicColoring && !fuseColors) {
+                diffuseParticleColors_native(
+                    particleX, particleY, ctx->particleGrade.data(),
+                    ctx->firstCellParticle.data(), ctx->cellParticleIds.data(),
+                    nP, ctx->pNumX, ctx->pNumY, ctx->pInvSpacing,
+                    ctx->particleRadius, dynamicColoring, colorDiffusionCoefficient);
+                lap(SIM_STAGE_COLOR_DIFFUSION);
+            }
+        }
+
+        // 3. Collisions
+        if (!fuseCollisions) {
+            handleCollisions_native(
+                particleX, particleY, particleVelX, particleVelY, nP, ctx->particleRadius,
+                isObstacleActive, obstacleX, obstacleY, obstacleRadius, obstacleVelX, obstacleVelY,
+                ctx->circleCenterX, ctx->circleCenterY, ctx->circleRadius);
+            lap(SIM_STAGE_COLLISIONS);
+        }
+
+        // 4. P2G
+        transferVelocities_native(
+            true, flipRatio,
+            ctx->u.data(), ctx->v.data(), ctx->du.data(), ctx->dv.data(),
+            ctx->prevU.data(), ctx->prevV.data(),
+            ctx->cellType.data(), ctx->s.data(),
+            particleX, particleY, particleVelX, particleVelY,
+            ctx->fNumX, ctx->fNumY, ctx->h, ctx->invH, nP, &ctx->fluidRuns, &ctx->transferScratch);
+        lap(SIM_STAGE_P2G);
+
+        // 5. Density grid, dynamic colors, rest density
+        updateParticleDensityGrid_native(
+            nP, ctx->particleRestDensity, ctx->invH, ctx->fNumX, ctx->fNumY, ctx->h,
+            particleX, particleY, ctx->particleDensity.data());
+
+        if (dynamicColoring) {
+            updateDynamicParticleColors_native(
+                nP, ctx->particleRestDensity, ctx->invH, ctx->fNumX, ctx->fNumY, ctx->h,
+                particleX, particleY, ctx->particleDensity.data(), ctx->particleGrade.data());
+        }
+
+        if (ctx->particleRestDensity == 0.0f) {
+            double sum = 0.0;
+            int count = 0;
+            for (int i = 0; i < ctx->fNumCells; ++i) {
+                if (ctx->cellType[i] == FLUID_CELL_CPP) {
+                    sum += ctx->particleDensity[i];
+                    count++;
+                }
+            }
+            if (count > 0) ctx->particleRestDensity = static_cast<float>(sum / count);
+        }
+        lap(SIM_STAGE_DENSITY);
+
+        // 6. Pressure solve (prevU/prevV hold the pre-solve grid velocities for the FLIP delta)
+        if (!ctx->pressureWarmStart) std::fill(ctx->p.begin(), ctx->p.end(), 0.0f);
+        std::copy(ctx->u.begin(), ctx->u.end(), ctx->prevU.begin());
+        std::copy(ctx->v.begin(), ctx->v.end(), ctx->prevV.begin());
+
+        solveIncompressibility_native(
+            ctx->u.data(), ctx->v.data(), ctx->p.data(), ctx->s.data(), ctx->cellType.data(),
+            ctx->particleDensity.data(), ctx->fNumX, ctx->fNumY, numPressureIters,
+            ctx->h, dt, ctx->density, overRelaxation,
+            ctx->particleRestDensity, compensateDrift,
+            ctx->circleCenterX, ctx->circleCenterY, ctx->circleRadius,
+            isObstacleActive, obstacleX, obstacleY, obstacleRadius, obstacleVelX, obstacleVelY,
+            ctx->pressureSolver, ctx->pressureTolerance, ctx->pressureCheckInterval,
+            ctx->pressureWarmStart, &ctx->fluidRuns, &ctx->boundaryMasks, &ctx->pressureWs);
+        lap(SIM_STAGE_PRESSURE);
+
+        // 7. G2P
+        transferVelocities_native(
+            false, flipRatio,
+            ctx->u.data(), ctx->v.data(), ctx->du.data(), ctx->dv.data(),
+            ctx->prevU.data(), ctx->prevV.data(),
+            ctx->cellType.data(), ctx->s.data(),
+            particleX, particleY, particleVelX, particleVelY,
+            ctx->fNumX, ctx->fNumY, ctx->h, ctx->invH, nP, nullptr, &ctx->transferScratch);
+        lap(SIM_STAGE_G2P);
+
+    }
+
+    // Clamps the particle count, advances the reorder frame counter and brings the
+    // SoA store up to date; returns whether this frame sorts the particle arrays.
+    static bool beginFrame_native(SimContext* ctx, int numParticles) {
+        applyThreadConfig_native(ctx);
+        ctx->numParticles = std::max(0, std::min(numParticles, ctx->maxParticles));
+        if (ctx->particleLayout == PARTICLE_LAYOUT_INTERLEAVED) {
+            importInterleavedParticles_native(ctx, ctx->numParticles);
+        }
+        std::fill(ctx->stageTimings.begin(), ctx->stageTimings.end(), 0.0f);
+        ctx->frameCount++;
+        return ctx->reorderInterval > 0 && ctx->frameCount % ctx->reorderInterval == 0;
+    }
+
+    static void endFrame_native(SimContext* ctx, double frameStart) {
+        if (ctx->particleLayout == PARTICLE_LAYOUT_INTERLEAVED) {
+            exportInterleavedParticles_native(ctx, ctx->numParticles);
+        }
+        ctx->stageTimings[SIM_STAGE_TOTAL] = static_cast<float>((omp_get_wtime() - frameStart) * 1000.0);
+    }
+
+    // Runs one full FLIP step of length dt on the context-owned buffers.
+    void sim_step(
+        SimContext* ctx, int numParticles,
+        float dt, float gravityX, float gravityY, float flipRatio,
+        int numPressureIters, int numParticleIters, float overRelaxation,
+        bool compensateDrift, bool separateParticles,
+        // Obstacle parameters
+        bool isObstacleActive, float obstacleX, float obstacleY, float obstacleRadius,
+        float obstacleVelX, float obstacleVelY
+    ) {
+        if (ctx == nullptr) return;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        const double frameStart = omp_get_wtime();
+        const bool reorder = beginFrame_native(ctx, numParticles);
+        simulateSubstep_native(
+            ctx, ctx->numParticles, dt, gravityX, gravityY, flipRatio,
+            numPressureIters, numParticleIters, overRelaxation, compensateDrift, separateParticles,
+            ctx->enableDynamicColoring, reorder,
+            isObstacleActive, obstacleX, obstacleY, obstacleRadius, obstacleVelX, obstacleVelY);
+        endFrame_native(ctx, frameStart);
+    } // End sim_step
+
+    // Feeds the last frame's cost into the governor and, once it has stayed over
+    // (under) budget long enough, lowers (raises) one quality setting.
+    // Downgrades first add a worker while the device is cool, then cut whichever
+    // of pressure iterations, separation iterations, separation or coloring the
+    // stage timings say saves the most. Upgrades restore passes, then iterations,
+    // then give workers back. Above the throttle temperature the budget shrinks
+    // and downgrades shed workers instead of adding them.
+    static void updateGovernor_native(SimContext* ctx, const SimFrameParams& requested) {
+        QualityGovernor& g = ctx->governor;
+        const float* t = ctx->stageTimings.data();
+        const float frameMs = t[SIM_STAGE_TOTAL];
+        g.smoothedMs = g.smoothedMs <= 0.0f ? frameMs : g.smoothedMs + GOVERNOR_SMOOTHING * (frameMs - g.smoothedMs);
+
+        const float temperature = g.temperature.load(std::memory_order_relaxed);
+        const bool hot = temperature > -900.0f && temperature >= g.throttleTemperature;
+        float budget = g.targetFrameMs;
+        if (hot) {
+            budget *= std::max(GOVERNOR_MIN_THERMAL_SCALE,
+                               1.0f - GOVERNOR_THERMAL_SLOPE * (temperature - g.throttleTemperature));
+        }
+
+        const int minPressure = std::min(g.minPressureIters, requested.numPressureIters);
+        const int minParticle = std::min(g.minParticleIters, requested.numParticleIters);
+        const int prevThreads = g.threads;
+        bool changed = false;
+        if (g.cooldown > 0) {
+            --g.cooldown;
+        } else if (g.smoothedMs > budget) {
+            g.underFrames = 0;
+            if (++g.overFrames >= GOVERNOR_DOWNGRADE_FRAMES) {
+                changed = true;
+                if (!hot && g.threads < g.maxThreads) {
+                    g.threads++;
+                } else if (hot && g.threads > g.minThreads) {
+                    g.threads--;
+                } else {
+                    // Estimated ms saved by each available cut
+                    const bool separating = requested.separateParticles && g.separation;
+                    const float pressureCut = g.pressureIters > minPressure
+                        ? t[SIM_STAGE_PRESSURE] * std::max(1, g.pressureIters / 4) / g.pressureIters : 0.0f;
+                    const float particleCut = separating && g.particleIters > minParticle
+                        ? t[SIM_STAGE_PUSH_APART] / g.particleIters : 0.0f;
+                    const float separationCut = separating && g.mayDropSeparation && g.particleIters <= minParticle
+                        ? t[SIM_STAGE_PARTICLE_GRID] + t[SIM_STAGE_PUSH_APART] + t[SIM_STAGE_COLOR_DIFFUSION] : 0.0f;
+                    const float coloringCut = ctx->enableDynamicColoring && g.coloring && g.mayDropColoring
+                        ? t[SIM_STAGE_COLOR_DIFFUSION] + 0.5f * t[SIM_STAGE_DENSITY] : 0.0f;
+                    const float best = std::max(std::max(pressureCut, particleCut), std::max(separationCut, coloringCut));
+                    if (best <= 0.0f) {
+                        changed = false; // Everything is at its lower bound
+                    } else if (best == pressureCut) {
+                        g.pressureIters = std::max(minPressure, g.pressureIters - std::max(1, g.pressureIters / 4));
+                    } else if (best == particleCut) {
+                        g.particleIters--;
+                    } else if (best == separationCut) {
+                        g.separation = false;
+                    } else {
+                        g.coloring = false;
+                    }
+                }
+            }
+        } else if (g.smoothedMs < GOVERNOR_UPGRADE_HEADROOM * budget) {
+            g.overFrames = 0;
+            if (++g.underFrames >= GOVERNOR_UPGRADE_FRAMES) {
+                changed = true;
+                if (!g.coloring) {
+                    g.coloring = true;
+                } else if (!g.separation) {
+                    g.separation = true;
+                } else if (g.particleIters < requested.numParticleIters) {
+                    g.particleIters++;
+                } else if (g.pressureIters < requested.numPressureIters) {
+                    g.pressureIters = std::min(requested.numPressureIters, g.pressureIters + std::max(1, g.pressureIters / 4));
+                } else if (g.threads > g.minThreads) {
+                    g.threads--;
+                } else {
+                    changed = false; // Already at full quality on the fewest workers
+                }
+            }
+        } else {
+            g.overFrames = g.underFrames = 0;
+        }
+        if (changed) {
+            g.overFrames = g.underFrames = 0;
+            g.cooldown = GOVERNOR_COOLDOWN_FRAMES;
+        }
+        if (g.threads != prevThreads) bumpThreadConfig_native(ctx);
+
+        g.state[GOVERNOR_STATE_PRESSURE_ITERS] = static_cast<float>(g.pressureIters);
+        g.state[GOVERNOR_STATE_PARTICLE_ITERS] = static_cast<float>(g.particleIters);
+        g.state[GOVERNOR_STATE_SEPARATION] = requested.separateParticles && g.separation ? 1.0f : 0.0f;
+        g.state[GOVERNOR_STATE_COLORING] = ctx->enableDynamicColoring && g.coloring ? 1.0f : 0.0f;
+        g.state[GOVERNOR_STATE_THREADS] = static_cast<float>(g.threads);
+        g.state[GOVERNOR_STATE_SMOOTHED_MS] = g.smoothedMs;
+        g.state[GOVERNOR_STATE_BUDGET_MS] = budget;
+    }
+
+    // Advances the simulation by frameDt in as many equal substeps as the CFL
+    // condition asks for (at most maxSubsteps), back to back without returning.
+    // The velocity bound is the largest particle / grid velocity (and obstacle
+    // speed) plus sqrt(5 h |g|) for what gravity adds within a substep, so no
+    // particle travels more than cflNumber cells per substep. Returns the number
+    // of substeps taken. The caller holds stepMutex.
+    static int stepFrame_native(SimContext* ctx, const SimFrameParams& requested) {
+        const double frameStart = omp_get_wtime();
+        SimFrameParams fp = requested;
+        bool dynamicColoring = ctx->enableDynamicColoring;
+        QualityGovernor& gov = ctx->governor;
+        if (gov.enabled) {
+            gov.pressureIters = std::max(std::min(gov.minPressureIters, requested.numPressureIters),
+                                         gov.pressureIters < 0 ? requested.numPressureIters
+                                                               : std::min(gov.pressureIters, requested.numPressureIters));
+            gov.particleIters = std::max(std::min(gov.minParticleIters, requested.numParticleIters),
+                                         gov.particleIters < 0 ? requested.numParticleIters
+                                                               : std::min(gov.particleIters, requested.numParticleIters));
+            fp.numPressureIters = gov.pressureIters;
+            fp.numParticleIters = gov.particleIters;
+            fp.separateParticles = requested.separateParticles && gov.separation;
+            dynamicColoring = dynamicColoring && gov.coloring;
+        }
+        const bool reorder = beginFrame_native(ctx, fp.numParticles);
+
+        float maxVel = maxVelocity_native(ctx, ctx->numParticles);
+        if (fp.isObstacleActive) maxVel = fmaxf(maxVel, sqrtf(fp.obstacleVelX * fp.obstacleVelX + fp.obstacleVelY * fp.obstacleVelY));
+        maxVel += sqrtf(5.0f * ctx->h * sqrtf(fp.gravityX * fp.gravityX + fp.gravityY * fp.gravityY));
+        const float maxTravel = std::max(fp.cflNumber, 1e-3f) * ctx->h;
+        const float cflSubsteps = ceilf(fp.frameDt * maxVel / maxTravel);
+        const int substeps = std::max(1, std::min(fp.maxSubsteps, cflSubsteps < 1e6f ? (int)cflSubsteps : fp.maxSubsteps));
+        const float dt = fp.frameDt / substeps;
+
+        for (int step = 0; step < substeps; ++step) {
+            simulateSubstep_native(
+                ctx, ctx->numParticles, dt, fp.gravityX, fp.gravityY, fp.flipRatio,
+                fp.numPressureIters, fp.numParticleIters, fp.overRelaxation, fp.compensateDrift, fp.separateParticles,
+                dynamicColoring, reorder && step == 0,
+                fp.isObstacleActive, fp.obstacleX, fp.obstacleY, fp.obstacleRadius, fp.obstacleVelX, fp.obstacleVelY);
+        }
+        endFrame_native(ctx, frameStart);
+        if (gov.enabled) updateGovernor_native(ctx, requested);
+        return substeps;
+    }
+
+    int32_t sim_step_frame(
+        SimContext* ctx, int numParticles,
+        float frameDt, int32_t maxSubsteps, float cflNumber,
+        float gravityX, float gravityY, float flipRatio,
+        int numPressureIters, int numParticleIters, float overRelaxation,
+        bool compensateDrift, bool separateParticles,
+        // Obstacle parameters
+        bool isObstacleActive, float obstacleX, float obstacleY, float obstacleRadius,
+        float obstacleVelX, float obstacleVelY
+    ) {
+        if (ctx == nullptr) return 0;
+        SimFrameParams fp;
+        fp.numParticles = numParticles;
+        fp.frameDt = frameDt;
+        fp.maxSubsteps = maxSubsteps;
+        fp.cflNumber = cflNumber;
+        fp.gravityX = gravityX; fp.gravityY = gravityY; fp.flipRatio = flipRatio;
+        fp.numPressureIters = numPressureIters; fp.numParticleIters = numParticleIters;
+        fp.overRelaxation = overRelaxation;
+        fp.compensateDrift = compensateDrift; fp.separateParticles = separateParticles;
+        fp.isObstacleActive = isObstacleActive;
+        fp.obstacleX = obstacleX; fp.obstacleY = obstacleY; fp.obstacleRadius = obstacleRadius;
+        fp.obstacleVelX = obstacleVelX; fp.obstacleVelY = obstacleVelY;
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        return stepFrame_native(ctx, fp);
+    }
+
+    // Stores the inputs the simulation thread uses for every following frame
+    // (same meaning as the sim_step_frame arguments). Never waits for a frame.
+    void sim_set_frame_params(
+        SimContext* ctx, int numParticles,
+        float frameDt, int32_t maxSubsteps, float cflNumber,
+        float gravityX, float gravityY, float flipRatio,
+        int numPressureIters, int numParticleIters, float overRelaxation,
+        bool compensateDrift, bool separateParticles,
+        // Obstacle parameters
+        bool isObstacleActive, float obstacleX, float obstacleY, float obstacleRadius,
+        float obstacleVelX, float obstacleVelY
+    ) {
+        if (ctx == nullptr) return;
+        std::lock_guard<std::mutex> lock(ctx->paramsMutex);
+        SimFrameParams& fp = ctx->frameParams;
+        fp.numParticles = numParticles;
+        fp.frameDt = frameDt;
+        fp.maxSubsteps = maxSubsteps;
+        fp.cflNumber = cflNumber;
+        fp.gravityX = gravityX; fp.gravityY = gravityY; fp.flipRatio = flipRatio;
+        fp.numPressureIters = numPressureIters; fp.numParticleIters = numParticleIters;
+        fp.overRelaxation = overRelaxation;
+        fp.compensateDrift = compensateDrift; fp.separateParticles = separateParticles;
+        fp.isObstacleActive = isObstacleActive;
+        fp.obstacleX = obstacleX; fp.obstacleY = obstacleY; fp.obstacleRadius = obstacleRadius;
+        fp.obstacleVelX = obstacleVelX; fp.obstacleVelY = obstacleVelY;
+    }
+
+    // Copies the render-facing state of the frame that just finished into the
+    // writer's slot and swaps it in as the latest snapshot.
+    static void publishSnapshot_native(SimContext* ctx, int substeps) {
+        SnapshotTripleBuffer& tb = ctx->snapshots;
+        SimSnapshot& snap = tb.slots[tb.writeSlot];
+        const int nP = ctx->numParticles;
+        std::copy(ctx->particleX.begin(), ctx->particleX.begin() + nP, snap.particleX.begin());
+        std::copy(ctx->particleY.begin(), ctx->particleY.begin() + nP, snap.particleY.begin());
+        std::copy(ctx->particleGrade.begin(), ctx->particleGrade.begin() + nP, snap.particleGrade.begin());
+        std::copy(ctx->cellType.begin(), ctx->cellType.end(), snap.cellType.begin());
+        std::copy(ctx->particleDensity.begin(), ctx->particleDensity.end(), snap.particleDensity.begin());
+        std::copy(ctx->stageTimings.begin(), ctx->stageTimings.end(), snap.stageTimings.begin());
+        snap.info[SNAPSHOT_INFO_NUM_PARTICLES] = static_cast<float>(nP);
+        snap.info[SNAPSHOT_INFO_REST_DENSITY] = ctx->particleRestDensity;
+        snap.info[SNAPSHOT_INFO_PRESSURE_ITERATIONS] = static_cast<float>(ctx->pressureWs.lastIterations);
+        snap.info[SNAPSHOT_INFO_PRESSURE_RESIDUAL] = ctx->pressureWs.lastResidual;
+        snap.info[SNAPSHOT_INFO_SUBSTEPS] = static_cast<float>(substeps);
+        std::copy(ctx->governor.state, ctx->governor.state + GOVERNOR_STATE_COUNT, snap.governorState);
+        const uint32_t previous = tb.latest.exchange(static_cast<uint32_t>(tb.writeSlot) | SnapshotTripleBuffer::FRESH,
+                                                     std::memory_order_acq_rel);
+        tb.writeSlot = static_cast<int>(previous & SnapshotTripleBuffer::SLOT_MASK);
+    }
+
+    // Advances the context every `period` seconds with the latest frame params
+    // until simThreadRunning is cleared. A frame that overruns its slot pushes the
+    // schedule back instead of being followed by catch-up frames.
+    static void simThreadLoop_native(SimContext* ctx, double period) {
+        using Clock = std::chrono::steady_clock;
+        const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period));
+        auto next = Clock::now();
+        std::vector<GridEdit> edits;
+        isSimThread = true;
+        while (ctx->simThreadRunning.load(std::memory_order_acquire)) {
+            SimFrameParams fp;
+            {
+                std::lock_guard<std::mutex> lock(ctx->paramsMutex);
+                fp = ctx->frameParams;
+                edits.swap(ctx->pendingGridEdits);
+            }
+            {
+                std::lock_guard<std::mutex> lock(ctx->stepMutex);
+                applyGridEdits_native(ctx, edits);
+                if (fp.frameDt > 0.0f) {
+                    const int substeps = stepFrame_native(ctx, fp);
+                    publishSnapshot_native(ctx, substeps);
+                }
+            }
+            next += interval;
+            const auto now = Clock::now();
+            if (next < now) next = now;
+            std::this_thread::sleep_until(next);
+        }
+    }
+
+    // Starts advancing the simulation on a native thread at stepsPerSecond frames
+    // per second, using the parameters of sim_set_frame_params. While it runs the
+    // caller reads frames through sim_acquire_snapshot instead of the live buffers.
+    bool sim_start_thread(SimContext* ctx, float stepsPerSecond) {
+        if (ctx == nullptr || stepsPerSecond <= 0.0f) return false;
+        if (ctx->simThreadRunning.load(std::memory_order_acquire)) return true;
+        {
+            std::lock_guard<std::mutex> lock(ctx->stepMutex);
+            const size_t particles = static_cast<size_t>(ctx->maxParticles);
+            const size_t cells = static_cast<size_t>(ctx->fNumCells);
+            SnapshotTripleBuffer& tb = ctx->snapshots;
+            for (SimSnapshot& snap : tb.slots) {
+                snap.particleX.assign(particles, 0.0f);
+                snap.particleY.assign(particles, 0.0f);
+                snap.particleGrade.assign(particles, 0);
+                snap.cellType.assign(cells, AIR_CELL_CPP);
+                snap.particleDensity.assign(cells, 0.0f);
+                snap.stageTimings.assign(SIM_STAGE_COUNT, 0.0f);
+                std::fill(snap.info, snap.info + SNAPSHOT_INFO_COUNT, 0.0f);
+                std::fill(snap.governorState, snap.governorState + GOVERNOR_STATE_COUNT, 0.0f);
+            }
+            tb.writeSlot = 0;
+            tb.readSlot = 1;
+            tb.readValid = false;
+            tb.latest.store(2, std::memory_order_release);
+        }
+        ctx->simThreadRunning.store(true, std::memory_order_release);
+        try {
+            ctx->simThread = std::thread(simThreadLoop_native, ctx, 1.0 / stepsPerSecond);
+        } catch (...) {
+            ctx->simThreadRunning.store(false, std::memory_order_release);
+            return false;
+        }
+        return true;
+    }
+
+    // Stops the simulation thread after its current frame; the live buffers are
+    // then safe to use directly again.
+    void sim_stop_thread(SimContext* ctx) {
+        if (ctx == nullptr) return;
+        stopSimThread_native(ctx);
+    }
+
+    // Returns the slot of the most recently completed snapshot, swapping it in
+    // for the reader if a newer one was published; -1 until the first frame.
+    // The slot stays untouched by the simulation thread until the next acquire.
+    int32_t sim_acquire_snapshot(SimContext* ctx) {
+        if (ctx == nullptr) return -1;
+        SnapshotTripleBuffer& tb = ctx->snapshots;
+        if (tb.latest.load(std::memory_order_relaxed) & SnapshotTripleBuffer::FRESH) {
+            const uint32_t previous = tb.latest.exchange(static_cast<uint32_t>(tb.readSlot), std::memory_order_acq_rel);
+            tb.readSlot = static_cast<int>(previous & SnapshotTripleBuffer::SLOT_MASK);
+            tb.readValid = true;
+        }
+        return tb.readValid ? tb.readSlot : -1;
+    }
+
+    // Zero-copy access to one snapshot slot: PARTICLE_X/Y and PARTICLE_GRADE hold
+    // the snapshot's particles, CELL_TYPE / PARTICLE_DENSITY the grid,
+    // STAGE_TIMINGS the frame's timings and SNAPSHOT_INFO its SnapshotInfo scalars.
+    void* sim_get_snapshot_buffer(SimContext* ctx, int32_t slot, int32_t bufferId) {
+        if (ctx == nullptr || slot < 0 || slot > 2) return nullptr;
+        SimSnapshot& snap = ctx->snapshots.slots[slot];
+        if (snap.stageTimings.empty()) return nullptr; // Thread never started
+        switch (bufferId) {
+            case SIM_BUFFER_PARTICLE_X: return snap.particleX.data();
+            case SIM_BUFFER_PARTICLE_Y: return snap.particleY.data();
+            case SIM_BUFFER_PARTICLE_GRADE: return snap.particleGrade.data();
+            case SIM_BUFFER_CELL_TYPE: return snap.cellType.data();
+            case SIM_BUFFER_PARTICLE_DENSITY: return snap.particleDensity.data();
+            case SIM_BUFFER_STAGE_TIMINGS: return snap.stageTimings.data();
+            case SIM_BUFFER_SNAPSHOT_INFO: return snap.info;
+            case SIM_BUFFER_GOVERNOR_STATE: return snap.governorState;
+            default: return nullptr;
+        }
+    }
+
+    // Applies a grid edit now, or queues it for the simulation thread's next frame.
+    static void submitGridEdit_native(SimContext* ctx, const GridEdit& edit) {
+        if (ctx->simThreadRunning.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(ctx->paramsMutex);
+            ctx->pendingGridEdits.push_back(edit);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(ctx->stepMutex);
+        if (edit.resetGrid) resetGrid_native(ctx); else applyObstacle_native(ctx, edit);
+    }
+
+    void sim_set_obstacle(SimContext* ctx, bool isObstacleActive,
+                          float obstacleX, float obstacleY, float obstacleRadius,
+                          float obstacleVelX, float obstacleVelY) {
+        if (ctx == nullptr) return;
+        GridEdit edit;
+        edit.isObstacleActive = isObstacleActive;
+        edit.obstacleX = obstacleX; edit.obstacleY = obstacleY; edit.obstacleRadius = obstacleRadius;
+        edit.obstacleVelX = obstacleVelX; edit.obstacleVelY = obstacleVelY;
+        submitGridEdit_native(ctx, edit);
+    }
+
+    void sim_reset_grid(SimContext* ctx) {
+        if (ctx == nullptr) return;
+        GridEdit edit;
+        edit.resetGrid = true;
+        submitGridEdit_native(ctx, edit);
+    }
 
 } // extern "C"
\ No newline at end of file
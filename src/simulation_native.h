@@ -0,0 +1,202 @@
+// Public C API of the native FLIP simulation: the sim_* entry points bound by
+// lib/flip_fluid_simulation.dart and the ids / modes they take. The Dart side
+// mirrors these by hand; native users (simulation_native.cpp itself, the desktop
+// benchmark and the tests) include this header so a changed signature or enum
+// value breaks their build. Each function is documented at its definition.
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Cell types in SIM_BUFFER_CELL_TYPE (renamed to avoid conflict if FLUID_CELL is a macro)
+const int FLUID_CELL_CPP = 0;
+const int AIR_CELL_CPP = 1;
+const int SOLID_CELL_CPP = 2;
+
+// Pressure solver modes (must match PressureSolver constants in flip_fluid_simulation.dart)
+const int PRESSURE_SOLVER_GAUSS_SEIDEL = 0;   // Original serial in-place sweep
+const int PRESSURE_SOLVER_RED_BLACK_SOR = 1;  // Checkerboard-ordered SOR, parallel + SIMD
+const int PRESSURE_SOLVER_PCG = 2;            // MIC(0)-preconditioned conjugate gradient
+const int PRESSURE_SOLVER_MGPCG = 3;          // Multigrid V-cycle preconditioned conjugate gradient
+
+// Particle separation modes (must match SeparationMode constants in flip_fluid_simulation.dart)
+const int SEPARATION_GAUSS_SEIDEL = 0; // Original serial in-place sweep
+const int SEPARATION_COLORED = 1;      // Parallel sweep over 9-colored hash cells (3x3 stride)
+const int SEPARATION_JACOBI = 2;       // Parallel accumulate-then-apply displacements
+
+// Particle layouts exposed through sim_get_buffer (must match ParticleLayout in flip_fluid_simulation.dart).
+// Kernels always run on the SoA arrays; in INTERLEAVED mode sim_step converts
+// from/to particlePos/particleVel around each step for callers that need them.
+const int PARTICLE_LAYOUT_INTERLEAVED = 0; // particlePos/particleVel as x0,y0,x1,y1,...
+const int PARTICLE_LAYOUT_SOA = 1;         // particleX/Y/VelX/VelY only, no conversion
+
+// Worker placement for sim_set_thread_config (must match ThreadAffinity in flip_fluid_simulation.dart)
+const int THREAD_AFFINITY_ANY = 0;    // Leave placement to the OS scheduler
+const int THREAD_AFFINITY_BIG = 1;    // Pin workers to the fastest cores (highest cpuinfo_max_freq)
+const int THREAD_AFFINITY_LITTLE = 2; // Pin workers to the slowest cores
+
+// Buffer ids for sim_get_buffer (must match SimBuffer constants in flip_fluid_simulation.dart)
+enum SimBufferId : int32_t {
+    SIM_BUFFER_U = 0,
+    SIM_BUFFER_V = 1,
+    SIM_BUFFER_DU = 2,
+    SIM_BUFFER_DV = 3,
+    SIM_BUFFER_PREV_U = 4,
+    SIM_BUFFER_PREV_V = 5,
+    SIM_BUFFER_P = 6,
+    SIM_BUFFER_S = 7,
+    SIM_BUFFER_CELL_TYPE = 8,
+    SIM_BUFFER_PARTICLE_DENSITY = 9,
+    SIM_BUFFER_PARTICLE_POS = 10,
+    SIM_BUFFER_PARTICLE_VEL = 11,
+    SIM_BUFFER_PARTICLE_GRADE = 12,      // uint16[maxParticles], unorm color grade
+    SIM_BUFFER_STAGE_TIMINGS = 13,       // float[SIM_STAGE_COUNT], ms of the last sim_step / sim_step_frame
+    SIM_BUFFER_PARTICLE_PERMUTATION = 14, // int32[maxParticles], old index of each particle after the last reorder
+    SIM_BUFFER_PARTICLE_X = 15,          // SoA particle store, float[maxParticles] each
+    SIM_BUFFER_PARTICLE_Y = 16,
+    SIM_BUFFER_PARTICLE_VEL_X = 17,
+    SIM_BUFFER_PARTICLE_VEL_Y = 18,
+    SIM_BUFFER_SNAPSHOT_INFO = 19,       // float[SNAPSHOT_INFO_COUNT], sim_get_snapshot_buffer only
+    SIM_BUFFER_GOVERNOR_STATE = 20,      // float[GOVERNOR_STATE_COUNT], settings chosen by the quality governor
+};
+
+// Quality governor outputs (must match GovernorState in flip_fluid_simulation.dart)
+enum GovernorStateField : int32_t {
+    GOVERNOR_STATE_PRESSURE_ITERS = 0,
+    GOVERNOR_STATE_PARTICLE_ITERS = 1,
+    GOVERNOR_STATE_SEPARATION = 2,   // 1 = particle separation on
+    GOVERNOR_STATE_COLORING = 3,     // 1 = dynamic coloring on
+    GOVERNOR_STATE_THREADS = 4,
+    GOVERNOR_STATE_SMOOTHED_MS = 5,  // Smoothed frame cost
+    GOVERNOR_STATE_BUDGET_MS = 6,    // Target after thermal scaling
+    GOVERNOR_STATE_COUNT = 7,
+};
+
+// Scalars published with every render snapshot (must match SnapshotInfo in flip_fluid_simulation.dart)
+enum SnapshotInfo : int32_t {
+    SNAPSHOT_INFO_NUM_PARTICLES = 0,
+    SNAPSHOT_INFO_REST_DENSITY = 1,
+    SNAPSHOT_INFO_PRESSURE_ITERATIONS = 2,
+    SNAPSHOT_INFO_PRESSURE_RESIDUAL = 3,
+    SNAPSHOT_INFO_SUBSTEPS = 4,
+    SNAPSHOT_INFO_COUNT = 5,
+};
+
+// Stages timed by sim_step (must match SimStage constants in flip_fluid_simulation.dart)
+enum SimStage : int32_t {
+    SIM_STAGE_INTEGRATE = 0,
+    SIM_STAGE_PARTICLE_GRID = 1, // Spatial hash build
+    SIM_STAGE_REORDER = 2,
+    SIM_STAGE_PUSH_APART = 3,
+    SIM_STAGE_COLOR_DIFFUSION = 4,
+    SIM_STAGE_COLLISIONS = 5,
+    SIM_STAGE_P2G = 6,
+    SIM_STAGE_DENSITY = 7,       // Density grid + dynamic colors
+    SIM_STAGE_PRESSURE = 8,
+    SIM_STAGE_G2P = 9,
+    SIM_STAGE_TOTAL = 10,
+    SIM_STAGE_COUNT = 11,
+};
+
+struct SimContext; // Opaque outside simulation_native.cpp
+
+extern "C" {
+    // --- Lifetime and buffers ---
+    SimContext* sim_create(
+        int fNumX, int fNumY, float h, float density,
+        int maxParticles, float particleRadius,
+        int pNumX, int pNumY, float pInvSpacing,
+        float circleCenterX, float circleCenterY, float circleRadius,
+        bool enableDynamicColoring);
+    void sim_destroy(SimContext* ctx);
+    void* sim_get_buffer(SimContext* ctx, int32_t bufferId);
+    float sim_get_particle_rest_density(SimContext* ctx);
+
+    // --- Configuration ---
+    void sim_set_pressure_solver(SimContext* ctx, int32_t pressureSolver);
+    void sim_set_pressure_tolerance(SimContext* ctx, float tolerance, int32_t checkInterval);
+    void sim_set_pressure_warm_start(SimContext* ctx, bool warmStart);
+    void sim_set_thread_config(SimContext* ctx, int32_t threadBudget, int32_t affinity, int32_t spinMillis);
+    void sim_set_governor(SimContext* ctx, bool enabled, float targetFrameMs,
+                          int32_t minPressureIters, int32_t minParticleIters,
+                          int32_t minThreads, int32_t maxThreads,
+                          bool mayDropSeparation, bool mayDropColoring,
+                          float throttleTemperature);
+    void sim_set_governor_temperature(SimContext* ctx, float celsius);
+    void sim_set_separation_mode(SimContext* ctx, int32_t mode);
+    void sim_set_particle_layout(SimContext* ctx, int32_t layout);
+    void sim_set_reorder_interval(SimContext* ctx, int32_t interval);
+    int32_t sim_get_pressure_iterations(SimContext* ctx);
+    float sim_get_pressure_residual(SimContext* ctx);
+
+    // --- Scene ---
+    int32_t sim_seed_particles(SimContext* ctx, int32_t targetCount);
+    float sim_get_seed_fill_height(SimContext* ctx);
+    void sim_set_obstacle(SimContext* ctx, bool isObstacleActive,
+                          float obstacleX, float obstacleY, float obstacleRadius,
+                          float obstacleVelX, float obstacleVelY);
+    void sim_reset_grid(SimContext* ctx);
+
+    // --- Stepping on the caller's thread ---
+    void sim_step(
+        SimContext* ctx, int numParticles,
+        float dt, float gravityX, float gravityY, float flipRatio,
+        int numPressureIters, int numParticleIters, float overRelaxation,
+        bool compensateDrift, bool separateParticles,
+        bool isObstacleActive, float obstacleX, float obstacleY, float obstacleRadius,
+        float obstacleVelX, float obstacleVelY);
+    int32_t sim_step_frame(
+        SimContext* ctx, int numParticles,
+        float frameDt, int32_t maxSubsteps, float cflNumber,
+        float gravityX, float gravityY, float flipRatio,
+        int numPressureIters, int numParticleIters, float overRelaxation,
+        bool compensateDrift, bool separateParticles,
+        bool isObstacleActive, float obstacleX, float obstacleY, float obstacleRadius,
+        float obstacleVelX, float obstacleVelY);
+
+    // --- Background simulation thread ---
+    void sim_set_frame_params(
+        SimContext* ctx, int numParticles,
+        float frameDt, int32_t maxSubsteps, float cflNumber,
+        float gravityX, float gravityY, float flipRatio,
+        int numPressureIters, int numParticleIters, float overRelaxation,
+        bool compensateDrift, bool separateParticles,
+        bool isObstacleActive, float obstacleX, float obstacleY, float obstacleRadius,
+        float obstacleVelX, float obstacleVelY);
+    bool sim_start_thread(SimContext* ctx, float stepsPerSecond);
+    void sim_stop_thread(SimContext* ctx);
+    int32_t sim_acquire_snapshot(SimContext* ctx);
+    void* sim_get_snapshot_buffer(SimContext* ctx, int32_t slot, int32_t bufferId);
+} // extern "C"
+
+// Grid and container for a width x height world, derived the way the
+// FlipFluidSimulation constructor does it (used by the desktop benchmark and tests).
+struct SimWorld {
+    int fNumX = 0, fNumY = 0, pNumX = 0, pNumY = 0;
+    float h = 0.0f, particleRadius = 0.0f, pInvSpacing = 0.0f;
+    float centerX = 0.0f, centerY = 0.0f, radius = 0.0f;
+};
+
+inline SimWorld simWorld(double width, double height, int cellsWide) {
+    SimWorld w;
+    const double h = width / cellsWide;
+    const double particleRadius = 0.3 * h;
+    const double pInvSpacing = 1.0 / (2.2 * particleRadius);
+    w.fNumX = cellsWide;
+    w.fNumY = static_cast<int>(std::floor(height / h)) + 1;
+    w.pNumX = static_cast<int>(std::floor(width * pInvSpacing)) + 1;
+    w.pNumY = static_cast<int>(std::floor(height * pInvSpacing)) + 1;
+    w.h = static_cast<float>(h);
+    w.particleRadius = static_cast<float>(particleRadius);
+    w.pInvSpacing = static_cast<float>(pInvSpacing);
+    w.centerX = static_cast<float>(w.fNumX * h / 2);
+    w.centerY = static_cast<float>(w.fNumY * h / 2);
+    w.radius = static_cast<float>(0.95 * 0.5 * std::fmin(w.fNumX * h, w.fNumY * h));
+    return w;
+}
+
+// Water density, dynamic coloring on
+inline SimContext* simCreateWorld(const SimWorld& w, int maxParticles) {
+    return sim_create(w.fNumX, w.fNumY, w.h, 1000.0f, maxParticles, w.particleRadius,
+                      w.pNumX, w.pNumY, w.pInvSpacing, w.centerX, w.centerY, w.radius, true);
+}
@@ -0,0 +1,94 @@
+// Color grade diffusion: isolated overlapping pairs must move closer in every
+// separation mode and in the standalone pass, including pairs whose difference
+// is too small for a plain rounded coeff step to register.
+#include "../simulation_native.cpp"
+#include "test_common.h"
+
+namespace {
+
+const float DIFFUSION_COEFF = 0.001f; // As in simulateSubstep_native
+const int PAIR_DIFFS[] = { 1, 2, 3, 100, 999, 20000 };
+const int NUM_PAIRS = sizeof(PAIR_DIFFS) / sizeof(PAIR_DIFFS[0]);
+const uint16_t BASE_GRADE = 30000;
+
+enum DiffusionPath { PATH_GAUSS_SEIDEL, PATH_COLORED, PATH_JACOBI, PATH_STANDALONE, PATH_COUNT };
+
+// One overlapping pair per spot, far enough apart that pairs never interact
+void placePairs(SimContext* ctx) {
+    const float r = ctx->particleRadius;
+    for (int k = 0; k < NUM_PAIRS; ++k) {
+        const float cx = 0.8f + 0.8f * (k % 3);
+        const float cy = 1.2f + 0.8f * (k / 3);
+        ctx->particleX[2 * k] = cx - 0.75f * r;
+        ctx->particleX[2 * k + 1] = cx + 0.75f * r;
+        ctx->particleY[2 * k] = cy;
+        ctx->particleY[2 * k + 1] = cy;
+        ctx->particleGrade[2 * k] = BASE_GRADE;
+        ctx->particleGrade[2 * k + 1] = static_cast<uint16_t>(BASE_GRADE + PAIR_DIFFS[k]);
+    }
+    ctx->numParticles = 2 * NUM_PAIRS;
+    buildParticleGrid_native(ctx);
+}
+
+void runPath(SimContext* ctx, DiffusionPath path) {
+    const float minDist = 2.0f * ctx->particleRadius;
+    float* x = ctx->particleX.data();
+    float* y = ctx->particleY.data();
+    uint16_t* grade = ctx->particleGrade.data();
+    switch (path) {
+        case PATH_GAUSS_SEIDEL:
+            pushParticlesApart_native(x, y, ctx->firstCellParticle.data(), ctx->cellParticleIds.data(),
+                                      ctx->numParticles, ctx->pNumX, ctx->pNumY, ctx->pInvSpacing, 1,
+                                      ctx->particleRadius, minDist * minDist, grade, DIFFUSION_COEFF);
+            break;
+        case PATH_COLORED:
+            pushParticlesApartColored_native(x, y, ctx->firstCellParticle.data(), ctx->cellParticleIds.data(),
+                                             ctx->pNumX, ctx->pNumY, 1,
+                                             ctx->particleRadius, minDist * minDist, grade, DIFFUSION_COEFF);
+            break;
+        case PATH_JACOBI:
+            pushParticlesApartJacobi_native(x, y, &ctx->separationScratch,
+                                            ctx->firstCellParticle.data(), ctx->cellParticleIds.data(),
+                                            ctx->numParticles, ctx->pNumX, ctx->pNumY, 1,
+                                            ctx->particleRadius, minDist * minDist, grade, DIFFUSION_COEFF);
+            break;
+        default:
+            diffuseParticleColors_native(x, y, grade, ctx->firstCellParticle.data(), ctx->cellParticleIds.data(),
+                                         ctx->numParticles, ctx->pNumX, ctx->pNumY, ctx->pInvSpacing,
+                                         ctx->particleRadius, true, DIFFUSION_COEFF);
+            break;
+    }
+}
+
+} // namespace
+
+int main() {
+    omp_set_num_threads(4);
+    SimContext* ctx = createTestContext(20, 2 * NUM_PAIRS);
+    SIM_CHECK(ctx != nullptr);
+    if (ctx == nullptr) return finishTest("color_diffusion_test");
+
+    for (int path = 0; path < PATH_COUNT; ++path) {
+        placePairs(ctx);
+        runPath(ctx, static_cast<DiffusionPath>(path));
+        for (int k = 0; k < NUM_PAIRS; ++k) {
+            const int lo = ctx->particleGrade[2 * k];
+            const int hi = ctx->particleGrade[2 * k + 1];
+            const int diff = PAIR_DIFFS[k];
+            SIM_CHECK(hi >= lo); // Never crosses over
+            SIM_CHECK(abs((lo + hi) - (2 * BASE_GRADE + diff)) <= 1);
+            if (diff >= 2) SIM_CHECK(hi - lo < diff);
+            else SIM_CHECK(hi - lo == diff);
+        }
+    }
+
+    // Repeated passes bring close grades together
+    placePairs(ctx);
+    for (int pass = 0; pass < 20000; ++pass) runPath(ctx, PATH_STANDALONE);
+    for (int k = 0; k < NUM_PAIRS; ++k) {
+        SIM_CHECK(ctx->particleGrade[2 * k + 1] - ctx->particleGrade[2 * k] <= 1);
+    }
+
+    sim_destroy(ctx);
+    return finishTest("color_diffusion_test");
+}
@@ -0,0 +1,138 @@
+// Pressure solvers on a small closed tank with an air layer on top: the Krylov
+// solvers (MIC(0)-PCG, MG-PCG) must reach the tolerance and end well below the
+// residual red-black SOR leaves after the same number of iterations.
+#include "../simulation_native.cpp"
+#include "test_common.h"
+
+#include <random>
+
+namespace {
+
+const int GRID_N = 40;        // Cells per side
+const int FLUID_TOP = 28;     // Rows 1..FLUID_TOP are fluid, the rest air
+const float GRID_H = 0.1f;
+const float DT = 1.0f / 60.0f;
+const float DENSITY = 1000.0f;
+const int NUM_ITERS = 100;
+
+struct TankScene {
+    int n = GRID_N;
+    std::vector<float> u, v, p, s, particleDensity;
+    std::vector<int32_t> cellType;
+
+    TankScene() {
+        const int cells = n * n;
+        u.assign(cells, 0.0f); v.assign(cells, 0.0f); p.assign(cells, 0.0f);
+        s.assign(cells, 1.0f); particleDensity.assign(cells, 0.0f);
+        cellType.assign(cells, AIR_CELL_CPP);
+        for (int i = 0; i < n; ++i) {
+            for (int j = 0; j < n; ++j) {
+                const int idx = i * n + j;
+                if (i == 0 || j == 0 || i == n - 1 || j == n - 1) {
+                    s[idx] = 0.0f;
+                    cellType[idx] = SOLID_CELL_CPP;
+                } else if (j <= FLUID_TOP) {
+                    cellType[idx] = FLUID_CELL_CPP;
+                }
+            }
+        }
+        // Random interior face velocities; faces touching a wall stay closed
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        for (int i = 1; i < n; ++i) {
+            for (int j = 1; j < n; ++j) {
+                const int idx = i * n + j;
+                if (s[idx] > 0.0f && s[idx - n] > 0.0f) u[idx] = dist(rng);
+                if (s[idx] > 0.0f && s[idx - 1] > 0.0f) v[idx] = dist(rng);
+            }
+        }
+    }
+
+    float maxFluidDivergence() const {
+        float result = 0.0f;
+        for (int i = 1; i < n - 1; ++i) {
+            for (int j = 1; j < n - 1; ++j) {
+                const int idx = i * n + j;
+                if (cellType[idx] != FLUID_CELL_CPP) continue;
+                result = fmaxf(result, fabsf((u[idx + n] - u[idx]) + (v[idx + 1] - v[idx])));
+            }
+        }
+        return result;
+    }
+
+    void solve(int solver, int numIters, float tolerance, int checkInterval, PressureWorkspace* ws) {
+        const float center = 0.5f * n * GRID_H;
+        solveIncompressibility_native(
+            u.data(), v.data(), p.data(), s.data(), cellType.data(), particleDensity.data(),
+            n, n, numIters, GRID_H, DT, DENSITY, 1.9f, 0.0f, false,
+            center, center, 10.0f * n * GRID_H, // Container circle covers the whole tank
+            false, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+            solver, tolerance, checkInterval, false, nullptr, nullptr, ws);
+    }
+};
+
+float maxAbsDifference(const std::vector<float>& a, const std::vector<float>& b) {
+    float result = 0.0f;
+    for (size_t k = 0; k < a.size(); ++k) result = fmaxf(result, fabsf(a[k] - b[k]));
+    return result;
+}
+
+float maxAbs(const std::vector<float>& a) {
+    float result = 0.0f;
+    for (const float x : a) result = fmaxf(result, fabsf(x));
+    return result;
+}
+
+} // namespace
+
+int main() {
+    omp_set_num_threads(4); // Exercise the parallel sweeps and reductions
+
+    const float initial = TankScene().maxFluidDivergence();
+    SIM_CHECK(initial > 0.5f);
+
+    const float tolerance = 1e-4f;
+    TankScene pcg;
+    PressureWorkspace pcgWs;
+    pcg.solve(PRESSURE_SOLVER_PCG, NUM_ITERS, tolerance, 1, &pcgWs);
+    const float pcgResidual = pcg.maxFluidDivergence();
+    SIM_CHECK(pcgWs.lastIterations > 0 && pcgWs.lastIterations < NUM_ITERS);
+    SIM_CHECK(pcgWs.lastResidual >= 0.0f && pcgWs.lastResidual <= tolerance);
+    SIM_CHECK(pcgResidual <= 10.0f * tolerance); // Recomputed in float from the face velocities
+
+    // Reference: red-black SOR given the same number of iterations
+    TankScene sor;
+    PressureWorkspace sorWs;
+    sor.solve(PRESSURE_SOLVER_RED_BLACK_SOR, pcgWs.lastIterations, 0.0f, 1, &sorWs);
+    const float sorResidual = sor.maxFluidDivergence();
+    SIM_CHECK(sorResidual < initial);
+    SIM_CHECK(pcgResidual < 0.1f * sorResidual);
+
+    // Multigrid-preconditioned CG: same system, no more iterations than MIC(0)
+    TankScene mg;
+    PressureWorkspace mgWs;
+    mg.solve(PRESSURE_SOLVER_MGPCG, NUM_ITERS, tolerance, 1, &mgWs);
+    const float mgResidual = mg.maxFluidDivergence();
+    SIM_CHECK(mgWs.lastIterations > 0 && mgWs.lastIterations <= pcgWs.lastIterations);
+    SIM_CHECK(mgWs.lastResidual >= 0.0f && mgWs.lastResidual <= tolerance);
+    SIM_CHECK(mgResidual <= 10.0f * tolerance);
+    SIM_CHECK(mgResidual < 0.1f * sorResidual);
+    SIM_CHECK(mgWs.mgLevels.size() > 1); // 40x40 coarsens at least once
+    // Both converge to the same pressure field
+    SIM_CHECK(maxAbsDifference(mg.p, pcg.p) <= 1e-2f * maxAbs(pcg.p));
+
+    printf("initial %.3g, pcg(%d) %.3g, mgpcg(%d) %.3g, rb-sor(%d) %.3g\n",
+           initial, pcgWs.lastIterations, pcgResidual, mgWs.lastIterations, mgResidual,
+           pcgWs.lastIterations, sorResidual);
+
+    // Early exit with several threads: every thread must leave the sweep loop together
+    TankScene sorTol;
+    PressureWorkspace sorTolWs;
+    const float sorTolerance = 1e-2f;
+    sorTol.solve(PRESSURE_SOLVER_RED_BLACK_SOR, 10 * NUM_ITERS, sorTolerance, 1, &sorTolWs);
+    SIM_CHECK(sorTolWs.lastIterations < 10 * NUM_ITERS);
+    SIM_CHECK(sorTolWs.lastResidual >= 0.0f && sorTolWs.lastResidual <= sorTolerance);
+    SIM_CHECK(sorTol.maxFluidDivergence() <= sorTolerance);
+
+    return finishTest("pressure_solver_test");
+}
@@ -0,0 +1,92 @@
+// sim_seed_particles: the bisection must pick the lowest water line (in steps of
+// one particle radius) that holds the requested count, and the lattice below it
+// must stay inside the container without overlaps.
+#include "../simulation_native.cpp"
+#include "test_common.h"
+
+namespace {
+
+const int MAX_PARTICLES = 4000;
+
+// Seeds targetCount particles and checks the lattice against the reported water line
+int seedAndCheck(SimContext* ctx, int targetCount) {
+    const int n = sim_seed_particles(ctx, targetCount);
+    const float fill = sim_get_seed_fill_height(ctx);
+    SIM_CHECK(n == ctx->numParticles);
+    SIM_CHECK(n <= std::min(std::max(targetCount, 0), MAX_PARTICLES));
+    if (n == 0) {
+        SIM_CHECK(fill == 0.0f);
+        return n;
+    }
+
+    const double r = ctx->particleRadius;
+    const double R = ctx->circleRadius;
+    const double bottom = ctx->circleCenterY - R;
+    SIM_CHECK(fill > 0.0f && fill <= 2.0 * R + r + 1e-4);
+    // Whole radius steps
+    const double steps = fill / r;
+    SIM_CHECK(fabs(steps - std::round(steps)) < 1e-3);
+
+    int outside = 0, aboveLine = 0, atTopStep = 0;
+    for (int i = 0; i < n; ++i) {
+        const double ex = ctx->particleX[i] - ctx->circleCenterX;
+        const double ey = ctx->particleY[i] - ctx->circleCenterY;
+        if (ex * ex + ey * ey >= (R - r) * (R - r) + 1e-4) ++outside;
+        if (ctx->particleY[i] >= bottom + fill + 1e-4) ++aboveLine;
+        if (ctx->particleY[i] >= bottom + fill - r - 1e-4) ++atTopStep;
+        if (ctx->particleVelX[i] != 0.0f || ctx->particleVelY[i] != 0.0f || ctx->particleGrade[i] != 0) ++outside;
+    }
+    SIM_CHECK(outside == 0);
+    SIM_CHECK(aboveLine == 0);
+    // One step lower would not have held the count: the top step is in use
+    if (n == targetCount) SIM_CHECK(atTopStep > 0);
+
+    // Lattice spacing is one diameter
+    double minDistSq = 1e30;
+    for (int i = 0; i < n; ++i) {
+        for (int j = i + 1; j < n; ++j) {
+            const double dx = ctx->particleX[i] - ctx->particleX[j];
+            const double dy = ctx->particleY[i] - ctx->particleY[j];
+            minDistSq = std::min(minDistSq, dx * dx + dy * dy);
+        }
+    }
+    SIM_CHECK(n < 2 || minDistSq >= 4.0 * r * r * (1.0 - 1e-4));
+
+    // The interleaved API view matches the SoA store
+    int mismatched = 0;
+    for (int i = 0; i < n; ++i) {
+        if (ctx->particlePos[2 * i] != ctx->particleX[i] || ctx->particlePos[2 * i + 1] != ctx->particleY[i]) ++mismatched;
+    }
+    SIM_CHECK(mismatched == 0);
+    return n;
+}
+
+} // namespace
+
+int main() {
+    SimContext* ctx = createTestContext(20, MAX_PARTICLES);
+    SIM_CHECK(ctx != nullptr);
+    if (ctx == nullptr) return finishTest("seed_particles_test");
+
+    SIM_CHECK(seedAndCheck(ctx, 0) == 0);
+    SIM_CHECK(seedAndCheck(ctx, -5) == 0);
+
+    // Counts that fit are met exactly, and the water line never drops as the count grows
+    float previousFill = 0.0f;
+    for (const int target : { 1, 7, 150, 400, 700 }) {
+        SIM_CHECK(seedAndCheck(ctx, target) == target);
+        const float fill = sim_get_seed_fill_height(ctx);
+        SIM_CHECK(fill >= previousFill);
+        previousFill = fill;
+    }
+
+    // More than the container holds: the whole disc is filled and the count is capped
+    const int full = seedAndCheck(ctx, MAX_PARTICLES);
+    SIM_CHECK(full > 700 && full < MAX_PARTICLES);
+    SIM_CHECK(sim_get_seed_fill_height(ctx) >= 2.0f * ctx->circleRadius);
+    SIM_CHECK(seedAndCheck(ctx, 10 * MAX_PARTICLES) == full);
+    printf("container holds %d particles, fill height %.3f\n", full, sim_get_seed_fill_height(ctx));
+
+    sim_destroy(ctx);
+    return finishTest("seed_particles_test");
+}
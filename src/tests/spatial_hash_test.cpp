@@ -0,0 +1,109 @@
+// Counting-sort particle hash: for several team sizes every cell must list
+// exactly its particles, in ascending index order (the sort is stable), and
+// reordering must permute every attribute consistently so that a rebuilt hash
+// is the identity.
+#include "../simulation_native.cpp"
+#include "test_common.h"
+
+#include <random>
+
+namespace {
+
+const int NUM_PARTICLES = 3001; // Not a multiple of any team size below
+
+int expectedCell(const SimContext* ctx, float x, float y) {
+    const int xi = std::min(std::max(static_cast<int>(floorf(x * ctx->pInvSpacing)), 0), ctx->pNumX - 1);
+    const int yi = std::min(std::max(static_cast<int>(floorf(y * ctx->pInvSpacing)), 0), ctx->pNumY - 1);
+    return xi * ctx->pNumY + yi;
+}
+
+// Checks the hash built from the current particle positions
+void checkHash(const SimContext* ctx) {
+    const int numParticles = ctx->numParticles;
+    std::vector<int> counts(ctx->pNumCells, 0);
+    for (int i = 0; i < numParticles; ++i) counts[expectedCell(ctx, ctx->particleX[i], ctx->particleY[i])]++;
+
+    SIM_CHECK(ctx->firstCellParticle[0] == 0);
+    SIM_CHECK(ctx->firstCellParticle[ctx->pNumCells] == numParticles);
+    std::vector<char> seen(numParticles, 0);
+    int badCounts = 0, badCells = 0, unstable = 0, duplicates = 0;
+    for (int c = 0; c < ctx->pNumCells; ++c) {
+        const int first = ctx->firstCellParticle[c];
+        const int last = ctx->firstCellParticle[c + 1];
+        if (last - first != counts[c] || ctx->numCellParticles[c] != counts[c]) ++badCounts;
+        for (int k = first; k < last; ++k) {
+            const int id = ctx->cellParticleIds[k];
+            if (id < 0 || id >= numParticles || seen[id]) { ++duplicates; continue; }
+            seen[id] = 1;
+            if (expectedCell(ctx, ctx->particleX[id], ctx->particleY[id]) != c) ++badCells;
+            if (k > first && ctx->cellParticleIds[k - 1] >= id) ++unstable;
+        }
+    }
+    SIM_CHECK(badCounts == 0);
+    SIM_CHECK(badCells == 0);
+    SIM_CHECK(unstable == 0);
+    SIM_CHECK(duplicates == 0);
+}
+
+} // namespace
+
+int main() {
+    SimContext* ctx = createTestContext(40, NUM_PARTICLES);
+    SIM_CHECK(ctx != nullptr);
+    if (ctx == nullptr) return finishTest("spatial_hash_test");
+
+    // Scattered particles, a few outside the world to exercise the clamp
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> pos(-0.2f, 4.2f);
+    std::uniform_real_distribution<float> vel(-1.0f, 1.0f);
+    std::uniform_int_distribution<int> grade(0, 65535);
+    for (int i = 0; i < NUM_PARTICLES; ++i) {
+        ctx->particleX[i] = pos(rng);
+        ctx->particleY[i] = pos(rng);
+        ctx->particleVelX[i] = vel(rng);
+        ctx->particleVelY[i] = vel(rng);
+        ctx->particleGrade[i] = static_cast<uint16_t>(grade(rng));
+    }
+    ctx->numParticles = NUM_PARTICLES;
+
+    for (const int threads : { 1, 3, 4, 8 }) {
+        omp_set_num_threads(threads);
+        buildParticleGrid_native(ctx);
+        checkHash(ctx);
+    }
+
+    // Reorder into cell order
+    const std::vector<float> oldX(ctx->particleX.begin(), ctx->particleX.begin() + NUM_PARTICLES);
+    const std::vector<float> oldY(ctx->particleY.begin(), ctx->particleY.begin() + NUM_PARTICLES);
+    const std::vector<float> oldVelX(ctx->particleVelX.begin(), ctx->particleVelX.begin() + NUM_PARTICLES);
+    const std::vector<float> oldVelY(ctx->particleVelY.begin(), ctx->particleVelY.begin() + NUM_PARTICLES);
+    const std::vector<uint16_t> oldGrade(ctx->particleGrade.begin(), ctx->particleGrade.begin() + NUM_PARTICLES);
+    const std::vector<int32_t> hashOrder(ctx->cellParticleIds.begin(), ctx->cellParticleIds.begin() + NUM_PARTICLES);
+    reorderParticles_native(ctx);
+
+    int badPerm = 0, badAttr = 0, notIdentity = 0;
+    for (int k = 0; k < NUM_PARTICLES; ++k) {
+        const int old = ctx->particlePermutation[k];
+        if (old != hashOrder[k]) { ++badPerm; continue; }
+        if (ctx->particleX[k] != oldX[old] || ctx->particleY[k] != oldY[old] ||
+            ctx->particleVelX[k] != oldVelX[old] || ctx->particleVelY[k] != oldVelY[old] ||
+            ctx->particleGrade[k] != oldGrade[old]) ++badAttr;
+        if (ctx->cellParticleIds[k] != k) ++notIdentity;
+    }
+    SIM_CHECK(badPerm == 0);
+    SIM_CHECK(badAttr == 0);
+    SIM_CHECK(notIdentity == 0);
+
+    // Particles are now in cell order, so a stable rebuild keeps them in place
+    for (const int threads : { 1, 4 }) {
+        omp_set_num_threads(threads);
+        buildParticleGrid_native(ctx);
+        checkHash(ctx);
+        int moved = 0;
+        for (int k = 0; k < NUM_PARTICLES; ++k) if (ctx->cellParticleIds[k] != k) ++moved;
+        SIM_CHECK(moved == 0);
+    }
+
+    sim_destroy(ctx);
+    return finishTest("spatial_hash_test");
+}
@@ -0,0 +1,30 @@
+// Shared helpers for the native tests. Each test compiles simulation_native.cpp
+// into its own executable so it can drive the internal kernels directly; a test
+// passes when main returns finishTest() == 0 (see src/CMakeLists.txt).
+#pragma once
+
+#include <cstdio>
+
+static int testFailures = 0;
+
+#define SIM_CHECK(cond)                                                            \
+    do {                                                                           \
+        if (!(cond)) {                                                             \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++testFailures;                                                        \
+        }                                                                          \
+    } while (0)
+
+static inline int finishTest(const char* name) {
+    if (testFailures == 0) {
+        printf("%s: ok\n", name);
+        return 0;
+    }
+    fprintf(stderr, "%s: %d check(s) failed\n", name, testFailures);
+    return 1;
+}
+
+// Context for a 4 x 4 world (include simulation_native.cpp before this header)
+static inline SimContext* createTestContext(int cellsWide, int maxParticles) {
+    return simCreateWorld(simWorld(4.0, 4.0, cellsWide), maxParticles);
+}